@@ -10,8 +10,31 @@
     		- http://www.willpirkle.com
 */
 // -----------------------------------------------------------------------------
-#include "plugincore.h"
+#include "PluginCore.h"
 #include "plugindescription.h"
+#include <cassert>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/** index of the lowest set bit; value must be non-zero */
+static inline uint32_t countTrailingZeros64(uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index = 0;
+	_BitScanForward64(&index, value);
+	return (uint32_t)index;
+#elif defined(_MSC_VER)
+	unsigned long index = 0;
+	if (_BitScanForward(&index, (unsigned long)value))
+		return (uint32_t)index;
+	_BitScanForward(&index, (unsigned long)(value >> 32));
+	return (uint32_t)index + 32;
+#else
+	return (uint32_t)__builtin_ctzll(value);
+#endif
+}
 
 /**
 \brief PluginCore constructor is launching pad for object initialization
@@ -50,6 +73,11 @@ PluginCore::PluginCore()
 
     // --- create the presets
     initPluginPresets();
+
+	// --- morph between the two factory presets until told otherwise; the defaults (or whatever
+	//     the host restores) stand until Morph is moved
+	loadMorphPresets(0, 1);
+	holdPresetMorph();
 }
 
 /**
@@ -160,6 +188,50 @@ bool PluginCore::initPluginParameters()
 	piParam->setBoundVariable(&noiseOutFIlter, boundVariableType::kDouble);
 	addPluginParameter(piParam);
 
+	// --- continuous control: Preset Morph
+	piParam = new PluginParameter(controlID::presetMorph, "Preset Morph", "", controlVariableType::kDouble, 0.000000, 1.000000, 0.000000, taper::kLinearTaper);
+	piParam->setParameterSmoothing(true);
+	piParam->setSmoothingTimeMsec(100.00);
+	piParam->setBoundVariable(&presetMorph, boundVariableType::kDouble);
+	addPluginParameter(piParam);
+
+	// --- discrete control: Tape Interp (the tape's read head interpolator, TapeInterpolation order)
+	piParam = new PluginParameter(controlID::tapeInterpolation, "Tape Interp", "linear,hermite,lagrange4,lagrange6,thiran,windowed sinc", "linear");
+	piParam->setBoundVariable(&tapeInterpolation, boundVariableType::kInt);
+	addPluginParameter(piParam);
+
+	// --- meter controls: output peaks and the wow, set from the telemetry ring on the GUI timer
+	//     (updateTelemetryMeters()) rather than from bound variables, so they cost the audio thread nothing
+	const struct { int32_t id; const char* name; } telemetryMeters[] = {
+		{ controlID::outputPeakL, "Out L" },
+		{ controlID::outputPeakR, "Out R" },
+		{ controlID::tapeWow, "Tape Wow" } };
+	for (const auto& meter : telemetryMeters)
+	{
+		piParam = new PluginParameter(meter.id, meter.name, 10.00, 500.00, ENVELOPE_DETECT_MODE_PEAK, meterCal::kLinearMeter);
+		piParam->setInvertedMeter(false);
+		piParam->setIsProtoolsGRMeter(false);
+		addPluginParameter(piParam);
+	}
+
+#if ECHOPLEX_STAGE_PROFILING
+	// --- meter controls: per-stage load, peak-detected so a slow buffer shows up
+	const struct { int32_t id; const char* name; float* variable; } loadMeters[] = {
+		{ controlID::loadParameters, "Load Params", &loadParameters },
+		{ controlID::loadModulator, "Load Modulator", &loadModulator },
+		{ controlID::loadTapeDelay, "Load Tape", &loadTapeDelay },
+		{ controlID::loadIO, "Load IO", &loadIO },
+		{ controlID::loadTotal, "Load Total", &loadTotal } };
+	for (const auto& meter : loadMeters)
+	{
+		piParam = new PluginParameter(meter.id, meter.name, 10.00, 500.00, ENVELOPE_DETECT_MODE_PEAK, meterCal::kLinearMeter);
+		piParam->setInvertedMeter(false);
+		piParam->setIsProtoolsGRMeter(false);
+		piParam->setBoundVariable(meter.variable, boundVariableType::kFloat);
+		addPluginParameter(piParam);
+	}
+#endif
+
 	// --- Aux Attributes
 	AuxParameterAttribute auxAttribute;
 
@@ -229,6 +301,11 @@ bool PluginCore::initPluginParameters()
 	auxAttribute.setUintAttribute(2147483648);
 	setParamAuxAttribute(controlID::noiseOutFIlter, auxAttribute);
 
+	// --- controlID::presetMorph
+	auxAttribute.reset(auxGUIIdentifier::guiControlData);
+	auxAttribute.setUintAttribute(2147483648);
+	setParamAuxAttribute(controlID::presetMorph, auxAttribute);
+
 
 	// **--0xEDA5--**
    
@@ -240,6 +317,27 @@ bool PluginCore::initPluginParameters()
 	// --- create the super fast access array
 	initPluginParameterArray();
 
+	// --- the editor's view of them
+	guiParameterView.build(pluginParameterArray, getPluginParameterCount());
+
+	// --- and the dense controlID table; every parameter but the bonus one needs a slot
+	for (uint32_t i = 0; i < getPluginParameterCount(); i++)
+	{
+		PluginParameter* parameter = getPluginParameterByIndex(i);
+		int32_t slot = getDenseControlSlot(parameter->getControlID());
+		assert(slot >= 0 || parameter->getControlID() == SCALE_GUI_SIZE || parameter->getControlVariableType() == controlVariableType::kMeter);
+		if (slot >= 0)
+		{
+			denseControlParameters[slot] = parameter;
+			storeControlValue(parameter->getControlID(), parameter);
+		}
+	}
+	for (uint32_t i = 0; i < kNumDenseControls; i++)
+		assert(denseControlParameters[i] != nullptr); // --- listed in kDenseControlIDs but never created
+
+	// --- first buffer syncs and cooks everything
+	dirtyControls.store(kNumDenseControls == 64 ? ~0ull : (1ull << kNumDenseControls) - 1);
+
     return true;
 }
 
@@ -259,25 +357,419 @@ bool PluginCore::reset(ResetInfo& resetInfo)
     // --- save for audio processing
     audioProcDescriptor.sampleRate = resetInfo.sampleRate;
     audioProcDescriptor.bitDepth = resetInfo.bitDepth;
+	// --- set the modulator up before resetting it; its drift noise table is built in reset
+	voiceModulator();
 	delayMod.reset(resetInfo.sampleRate);
+	if (hasPendingModulatorState)
+	{
+		// --- a restored session picks its wow and flutter up where it was saved
+		delayMod.setModulatorState(pendingModulatorState);
+		hasPendingModulatorState = false;
+	}
 	tapeDelay.reset(resetInfo.sampleRate);
-	EchoplexTapeDelayParameters tapeParams = tapeDelay.getParameters();
-	tapeParams.algorithm = delayAlgorithm::kNormal;
-	tapeDelay.setParameters(tapeParams);
+	telemetry.reset(resetInfo.sampleRate);
+#if ECHOPLEX_STAGE_PROFILING
+	stageProfiler.reset(resetInfo.sampleRate);
+#endif
+
+	// --- transport resets at the same rate only clear (tapeDelay.reset flushes), they don't reallocate
+	double capacity_mSec = getTapeCapacity_mSec();
+	if (resetInfo.sampleRate != tapeDelaySampleRate || capacity_mSec != tapeDelayCapacity_mSec)
+	{
+		tapeDelayCapacity_mSec = capacity_mSec;
+		tapeDelaySampleRate = resetInfo.sampleRate;
+		tapeDelay.createDelayBuffers(resetInfo.sampleRate, tapeDelayCapacity_mSec);
+	}
+
+	// --- a restored session's comb and tape contents, now that both are sized and cleared
+	if (!pendingDelaySnapshots.empty())
+		loadPendingDelaySnapshots();
+
+    // --- other reset inits
+    return PluginBase::reset(resetInfo);
+}
+/** the modulator's fixed voicing: drift depth, hum and the drift noise filter (the knobs don't reach these) */
+void PluginCore::voiceModulator()
+{
 	EchoplexDelayModulatorParameters paramsAF = delayMod.getParameters();
 	paramsAF.noiseDepth_Pct = 1.0;
 	paramsAF.sixtyHzNoiseAmp = 0.1;
 	paramsAF.noiseFilterFc_Hz = 50.0;
 	paramsAF.noiseFilterAmplitude = 0.5;
 	delayMod.setParameters(paramsAF);
+}
 
-    // --- other reset inits
-    return PluginBase::reset(resetInfo);
+/** tape length: the real Delay Time range plus the modulator's worst case excursion; also sets the Tape Wow meter's full scale */
+double PluginCore::getTapeCapacity_mSec()
+{
+	PluginParameter* delayParam = getPluginParameterByControlID(controlID::delayTime_ms);
+	PluginParameter* lfoDepthParam = getPluginParameterByControlID(controlID::lfoModDepth);
+	double maxDelay_mSec = delayParam ? delayParam->getMaxValue() : 680.0;
+	maxModulationDepth_mSec = delayMod.getMaxModulationDepth_mSec(maxDelay_mSec, lfoDepthParam ? lfoDepthParam->getMaxValue() : 100.0);
+	return maxDelay_mSec + maxModulationDepth_mSec;
+}
+
+/** total bytes held by this instance's delay lines (tape + scalloping comb), as each object reports them */
+size_t PluginCore::getDelayMemoryBytes()
+{
+	return tapeDelay.getDelayMemoryBytes() + delayMod.getDelayMemoryBytes();
+}
+
+/** set a control's value and, for smoothed controls, its smoothing target too, so it jumps there and stays */
+static void jumpControlValue(PluginParameter* piParam, double value)
+{
+	piParam->setControlValue(value);		// --- the smoothing target (the value itself when not smoothed)
+	piParam->setControlValue(value, true);	// --- the current value: no glide
+}
+
+/**
+\brief pre-cook two presets for the Morph control (main thread)
+
+The table is built in this writer's own buffer and swapped into the middle of a triple
+buffer, so it never waits on the audio thread; the audio thread takes it at the top of the
+next buffer and applies the morph at the current Morph position, so new presets take effect
+even with the knob at rest.
+
+Delay time is interpolated as tape speed (1/delay), the way a varispeed tape machine glides
+between two echo times, so the read head moves smoothly instead of jumping; filter
+frequencies are interpolated on a log scale, everything else (dB, percent, units) linearly.
+
+\return false if either preset index is out of range
+*/
+bool PluginCore::loadMorphPresets(uint32_t presetIndexA, uint32_t presetIndexB)
+{
+	double valuesA[kNumDenseControls];
+	double valuesB[kNumDenseControls];
+	if (!getPresetControlValues(presetIndexA, valuesA) || !getPresetControlValues(presetIndexB, valuesB))
+		return false;
+
+	std::lock_guard<std::mutex> writerLock(morphWriterMutex);
+	PresetMorphTable& table = morphTables[morphWriteTable];
+	table.morphed = 0;
+	table.moving = 0;
+	for (uint32_t slot = 0; slot < kNumDenseControls; slot++)
+	{
+		int32_t id = kDenseControlIDs[slot];
+		double valueA = valuesA[slot];
+		double valueB = valuesB[slot];
+
+		switch (id)
+		{
+			case controlID::presetMorph:
+			case controlID::tapeInterpolation:
+				table.curve[slot] = MorphCurve::none;
+				break;
+			case controlID::delayTime_ms:
+				table.curve[slot] = MorphCurve::tapeSpeed;
+				valueA = 1.0 / valueA;
+				valueB = 1.0 / valueB;
+				break;
+			case controlID::noiseFilter_Hz:
+			case controlID::noiseOutFIlter:
+				table.curve[slot] = MorphCurve::logarithmic;
+				valueA = log(valueA);
+				valueB = log(valueB);
+				break;
+			default:
+				table.curve[slot] = MorphCurve::linear;
+				break;
+		}
+		table.from[slot] = valueA;
+		table.to[slot] = valueB;
+		if (table.curve[slot] != MorphCurve::none)
+		{
+			table.morphed |= 1ull << slot;
+			if (valueA != valueB)
+				table.moving |= 1ull << slot;
+		}
+	}
+
+	// --- publish: our table becomes the middle one, and the old middle (taken or not) our next
+	morphHeld.store(false, std::memory_order_release);
+	uint32_t previous = morphMiddleTable.exchange(morphWriteTable | kMorphTableFresh, std::memory_order_acq_rel);
+	morphWriteTable = previous & kMorphTableIndexMask;
+	return true;
+}
+
+/**
+\brief set the morphed controls to their morphed value: lerp, inverse transform, bound variable, cook
+
+Allocation free; runs on the audio thread every kPresetMorphStepFrames while the (smoothed) Morph
+value moves. A new table sets every control it morphs; after that a step only touches the
+controls whose two presets differ. Touching any of those afterwards simply overrides it until
+Morph moves again.
+*/
+void PluginCore::applyPresetMorph(double morph)
+{
+	const PresetMorphTable& morphTable = morphTables[morphReadTable];
+	uint64_t slots = appliedMorph < 0.0 ? morphTable.morphed : morphTable.moving;
+	while (slots)
+	{
+		uint32_t slot = countTrailingZeros64(slots);
+		slots &= slots - 1;
+		MorphCurve curve = morphTable.curve[slot];
+		PluginParameter* piParam = denseControlParameters[slot];
+		if (!piParam)
+			continue;
+
+		double value = morphTable.from[slot] + morph * (morphTable.to[slot] - morphTable.from[slot]);
+		if (curve == MorphCurve::tapeSpeed)
+			value = 1.0 / value;
+		else if (curve == MorphCurve::logarithmic)
+			value = exp(value);
+
+		jumpControlValue(piParam, value); // --- the morph itself is smoothed; don't smooth twice
+		piParam->updateInBoundVariable();
+		controlValues.actualValue[slot] = piParam->getControlValue();
+		cookControl(kDenseControlIDs[slot]);
+		movedControls |= 1ull << slot;
+	}
+	appliedMorph = morph;
+}
+
+/**
+\brief load a preset from the memory-mapped bank by name
+
+Binary search of the bank's hash index, then one pass over that preset's row; the values are
+read straight from the mapping, so nothing is allocated. Controls are jumped to (no smoothing)
+and flagged dirty, so the bound variables sync at the top of the next buffer like any other
+parameter change. Bank columns for controls this build doesn't have are skipped.
+
+\return false if no bank is open or it has no preset by that name
+*/
+bool PluginCore::applyBankPreset(const char* presetName)
+{
+	int32_t presetNumber = presetBank.find(presetName);
+	if (presetNumber < 0)
+		return false;
+
+	const double* values = presetBank.getPresetValues((uint32_t)presetNumber);
+	holdPresetMorph();
+	for (uint32_t column = 0; column < presetBank.getControlCount(); column++)
+	{
+		int32_t id = presetBank.getControlID(column);
+		PluginParameter* piParam = getControlParameter(id);
+		if (!piParam)
+			continue;
+		jumpControlValue(piParam, values[column]);
+		storeControlValue(id, piParam);
+	}
+	return true;
+}
+
+/**
+\brief load a preset by name: the compiled-in factory presets first, then the external bank
+
+Same jump-and-flag path as applyBankPreset(), for hosts and tools that only know a name.
+
+\return false if neither has a preset by that name
+*/
+bool PluginCore::applyPresetByName(const char* presetName)
+{
+	for (uint32_t i = 0; i < PluginBase::getPresetCount(); i++)
+	{
+		PresetInfo* preset = PluginBase::getPreset(i);
+		if (!preset || preset->presetName != presetName)
+			continue;
+		holdPresetMorph();
+		for (PresetParameter& parameter : preset->presetParameters)
+		{
+			PluginParameter* piParam = getControlParameter(parameter.controlID);
+			if (!piParam)
+				continue;
+			jumpControlValue(piParam, parameter.actualValue);
+			storeControlValue(parameter.controlID, piParam);
+		}
+		return true;
+	}
+	return applyBankPreset(presetName);
+}
+
+/**
+\brief write the compiled-in presets out as a bank (main thread; allocates)
+
+A starting point for a house library: edit or extend the result with the same writer.
+*/
+bool PluginCore::exportPresetBank(const char* path)
+{
+	std::vector<int32_t> bankControlIDs(kDenseControlIDs, kDenseControlIDs + kNumDenseControls);
+	std::vector<std::string> presetNames;
+	std::vector<double> presetValues;
+	for (uint32_t i = 0; i < PluginBase::getPresetCount(); i++)
+	{
+		PresetInfo* preset = PluginBase::getPreset(i);
+		if (!preset)
+			continue;
+		presetNames.push_back(preset->presetName);
+		for (uint32_t slot = 0; slot < kNumDenseControls; slot++)
+		{
+			double value = denseControlParameters[slot] ? denseControlParameters[slot]->getDefaultValue() : 0.0;
+			for (PresetParameter& parameter : preset->presetParameters)
+				if ((int32_t)parameter.controlID == kDenseControlIDs[slot]) value = parameter.actualValue;
+			presetValues.push_back(value);
+		}
+	}
+	return PresetBank::writeBank(path, bankControlIDs, presetNames, presetValues);
+}
+
+/**
+\brief serialize the plugin state as a versioned binary chunk (main thread, not while processing)
+
+Parameters are stored as { controlID, actual value } pairs so a chunk stays loadable when
+controls are added or reordered. With includeModulators the LFO and drift noise positions and
+the scalloping comb's memory go in too - reset() randomizes and clears them, so without this a
+recalled session wobbles differently. With includeTape the written part of the tape goes in,
+as raw floats (see TapeEchoDelay::saveSnapshot()).
+
+\return true on success
+*/
+bool PluginCore::getStateChunk(std::vector<uint8_t>& chunk, bool includeModulators, bool includeTape)
+{
+	chunk.clear();
+	chunk.reserve(128 + kNumDenseControls * (sizeof(int32_t) + sizeof(double)) + sizeof(EchoplexModulatorState) +
+		(includeModulators ? delayMod.getDelayMemoryBytes() : 0) + (includeTape ? tapeDelay.getDelayMemoryBytes() : 0));
+	StateChunkWriter writer(chunk);
+	writer.writeHeader(kStateChunkMagic, kStateChunkVersion);
+
+	size_t section = writer.beginSection(kStateSectionParameters);
+	writer.writeValue(kNumDenseControls);
+	for (uint32_t slot = 0; slot < kNumDenseControls; slot++)
+	{
+		writer.writeValue(kDenseControlIDs[slot]);
+		writer.writeValue(denseControlParameters[slot] ? denseControlParameters[slot]->getControlValue() : 0.0);
+	}
+	writer.endSection(section);
+
+	if (includeModulators)
+	{
+		EchoplexModulatorState state = delayMod.getModulatorState();
+		section = writer.beginSection(kStateSectionModulators);
+		for (int i = 0; i < 3; i++)
+			writer.writeValue(state.lfoPhase[i]);
+		writer.writeValue(state.noise.humPhase);
+		writer.writeValue(state.noise.noiseTableIndex);
+		writer.writeValue((uint8_t)state.noise.reverseNoiseTable);
+		writer.endSection(section);
+
+		section = writer.beginSection(kStateSectionModulatorComb);
+		delayMod.saveCombSnapshot(writer);
+		writer.endSection(section);
+	}
+	if (includeTape)
+	{
+		size_t section = writer.beginSection(kStateSectionTape);
+		tapeDelay.saveSnapshot(writer);
+		writer.endSection(section);
+	}
+	return true;
 }
+
+/**
+\brief restore a getStateChunk() chunk (main thread)
+
+Parameters are jumped to their values and flagged dirty, so they sync at the top of the next
+buffer. Modulator positions, the comb's memory and the tape contents are held until the next
+reset(), which would otherwise randomize or clear them again - a host restores a session before
+it starts processing. Unknown sections (from newer builds) are skipped.
+
+\return false if the chunk isn't ours, is from an incompatible version or is truncated
+*/
+bool PluginCore::setStateChunk(const uint8_t* data, size_t size)
+{
+	StateChunkReader reader(data, size);
+	uint32_t version = 0;
+	if (!reader.readHeader(kStateChunkMagic, version) || version != kStateChunkVersion)
+		return false;
+
+	uint32_t tag = 0;
+	StateChunkReader section(nullptr, 0);
+	pendingDelaySnapshots.clear();
+	StateChunkWriter pendingWriter(pendingDelaySnapshots);
+	while (!reader.atEnd())
+	{
+		if (!reader.nextSection(tag, section))
+			return false;
+
+		if (tag == kStateSectionParameters)
+		{
+			uint32_t count = 0;
+			if (!section.readValue(count))
+				return false;
+			holdPresetMorph();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				int32_t id = 0;
+				double value = 0.0;
+				if (!section.readValue(id) || !section.readValue(value))
+					return false;
+				PluginParameter* piParam = getControlParameter(id);
+				if (!piParam)
+					continue;
+				jumpControlValue(piParam, value);
+				storeControlValue(id, piParam);
+			}
+		}
+		else if (tag == kStateSectionModulators)
+		{
+			EchoplexModulatorState state;
+			uint8_t reverse = 0;
+			bool ok = true;
+			for (int i = 0; i < 3; i++)
+				ok = ok && section.readValue(state.lfoPhase[i]);
+			ok = ok && section.readValue(state.noise.humPhase) && section.readValue(state.noise.noiseTableIndex) && section.readValue(reverse);
+			if (!ok)
+				return false;
+			state.noise.reverseNoiseTable = reverse != 0;
+			pendingModulatorState = state;
+			hasPendingModulatorState = true;
+		}
+		else if (tag == kStateSectionModulatorComb || tag == kStateSectionTape)
+		{
+			// --- kept as sections of their own until reset() has sized the delay lines
+			size_t pending = pendingWriter.beginSection(tag);
+			pendingWriter.writeArray(section.getData(), section.getSize());
+			pendingWriter.endSection(pending);
+		}
+	}
+	return true;
+}
+
+/** load the comb and tape sections setStateChunk() kept; end of reset(), after the delay lines are sized and cleared */
+void PluginCore::loadPendingDelaySnapshots()
+{
+	StateChunkReader reader(pendingDelaySnapshots.data(), pendingDelaySnapshots.size());
+	uint32_t tag = 0;
+	StateChunkReader section(nullptr, 0);
+	while (!reader.atEnd() && reader.nextSection(tag, section))
+	{
+		if (tag == kStateSectionModulatorComb)
+			delayMod.loadCombSnapshot(section);
+		else if (tag == kStateSectionTape)
+			tapeDelay.loadSnapshot(section);
+	}
+	pendingDelaySnapshots.clear();
+}
+
 void PluginCore::updateParameters() {
-	noiseLevel_cooked = pow(10.0, noiseLevel_dB / 20.0);
-	playbackLevel_cooked = pow(10.0, playbackLevel_dB / 20);
-	recordLevel_cooked = pow(10.0, recordLevel_dB / 20);
+	// --- only while the morph control is moving (or new morph presets came in: appliedMorph < 0),
+	//     and then once per kPresetMorphStepFrames; at rest the other controls are free, and after a
+	//     restore Morph is only tracked until it's moved
+	if (morphHeld.load(std::memory_order_acquire))
+		appliedMorph = presetMorph;
+	else if (morphStepCountdown == 0 && presetMorph != appliedMorph)
+	{
+		applyPresetMorph(presetMorph);
+		morphStepCountdown = kPresetMorphStepFrames;
+	}
+	if (morphStepCountdown > 0)
+		morphStepCountdown--;
+
+	// --- noise and record levels are cooked in cookControl() when they change; playback is smoothed
+	if (playbackLevel_dB != playbackLevel_cookedFor_dB || playbackLevel_cooked == 0.0)
+	{
+		playbackLevel_cooked = pow(10.0, playbackLevel_dB / 20);
+		playbackLevel_cookedFor_dB = playbackLevel_dB;
+	}
 	EchoplexDelayModulatorParameters params = delayMod.getParameters();
 	params.delayTime = delayTime_ms;
 	params.lfoDepth_Pct = lfoModDepth;
@@ -286,19 +778,23 @@ void PluginCore::updateParameters() {
 	params.noiseFilterFc_Hz = 50.0;
 	params.noiseFilterAmplitude = 0.5;
 	delayMod.setParameters(params);
+	STAGE_PROFILE_LAP(stageProfiler, kStageParameters);
 	SignalGenData y = delayMod.renderAudioOutput();
-	EchoplexTapeDelayParameters tapeParamsAF = tapeDelay.getParameters();
+	STAGE_PROFILE_LAP(stageProfiler, kStageModulator);
+	telemetry.recordModulation(y.normalOutput, y.normalOutput - delayTime_ms, noiseLevel_cooked);
+	TapeEchoDelayParameters tapeParamsAF = tapeDelay.getParameters();
+	tapeParamsAF.interpolation = (TapeInterpolation)tapeInterpolation;
 	tapeParamsAF.leftDelay_mSec = y.normalOutput;
 	tapeParamsAF.rightDelay_mSec = y.normalOutput;
 	tapeParamsAF.feedback_Pct = feedBack_pct;
 	tapeParamsAF.wetLevel_dB = wetMix;
 	tapeParamsAF.dryLevel_dB = dryMix;
 	tapeParamsAF.noiseLevel = noiseLevel_cooked;
-	tapeParamsAF.recordLevel_dB = recordLevel_cooked;
-	tapeParamsAF.playbackLevel_dB = playbackLevel_cooked;
+	tapeParamsAF.recordLevel = recordLevel_cooked;
+	tapeParamsAF.playbackLevel = playbackLevel_cooked;
 	tapeParamsAF.noiseFreq = noiseOutFIlter;
 	tapeDelay.setParameters(tapeParamsAF);
-
+	STAGE_PROFILE_LAP(stageProfiler, kStageParameters);
 }
 /**
 \brief one-time initialize function called after object creation and before the first reset( ) call
@@ -309,7 +805,108 @@ Operation:
 bool PluginCore::initialize(PluginInfo& pluginInfo)
 {
 	// --- add one-time init stuff here
+	// --- one pre-faulted block for the tape and the modulator's comb and noise table, laid out for the highest
+	//     rate we support; resets at any lower rate reuse a prefix of each region (see dspArena.getLayoutReport())
+	voiceModulator();
+	double tapeCapacity_mSec = getTapeCapacity_mSec();
+	dspArena.reserve(TapeEchoDelay::getArenaBytes(kDSPArenaMaxSampleRate, tapeCapacity_mSec) + delayMod.getArenaBytes(kDSPArenaMaxSampleRate), true);
+	tapeDelay.attachArena(dspArena, kDSPArenaMaxSampleRate, tapeCapacity_mSec);
+	delayMod.attachArena(dspArena, kDSPArenaMaxSampleRate);
+
+	if (pluginInfo.pathToDLL)
+	{
+		pluginDirectory = pluginInfo.pathToDLL;
+		size_t separator = pluginDirectory.find_last_of("/\\");
+		pluginDirectory = separator == std::string::npos ? std::string() : pluginDirectory.substr(0, separator + 1);
+	}
+
+	// --- optional preset library next to the plugin binary; mapping it costs the same for ten
+	//     presets or ten thousand, and the host's preset list reads it on demand (getPreset())
+	if (!pluginDirectory.empty())
+		presetBank.open((pluginDirectory + "Echoplex.epbk").c_str());
+
+	return true;
+}
+
+/**
+\brief preset list entry: the compiled-in presets, then the bank's in index order
+
+A bank preset has no PresetInfo of its own; one is filled in from the mapping for the caller
+(main thread), valid until the next call. Its parameters are the defaults overridden by the
+bank's columns, like a compiled-in preset's.
+
+\return nullptr if out of range (or the bank's index entry is corrupt)
+*/
+PresetInfo* PluginCore::getPreset(uint32_t index)
+{
+	uint32_t numFactoryPresets = (uint32_t)PluginBase::getPresetCount();
+	if (index < numFactoryPresets)
+		return PluginBase::getPreset(index);
+
+	uint32_t presetNumber = 0;
+	const char* name = presetBank.getPresetName(index - numFactoryPresets, presetNumber);
+	if (!name)
+		return nullptr;
+	const double* values = presetBank.getPresetValues(presetNumber);
+
+	bankPresetInfo.presetIndex = index;
+	bankPresetInfo.presetName = name;
+	bankPresetInfo.presetParameters.clear();
+	initPresetParameters(bankPresetInfo.presetParameters);
+	for (uint32_t column = 0; column < presetBank.getControlCount(); column++)
+	{
+		int32_t id = presetBank.getControlID(column);
+		if (getControlParameter(id))
+			setPresetParameter(bankPresetInfo.presetParameters, id, values[column]);
+	}
+	return &bankPresetInfo;
+}
+
+/** preset list name, straight from the mapping for a bank preset; nullptr if out of range */
+const char* PluginCore::getPresetName(uint32_t index)
+{
+	uint32_t numFactoryPresets = (uint32_t)PluginBase::getPresetCount();
+	if (index < numFactoryPresets)
+		return PluginBase::getPresetName(index);
+	uint32_t presetNumber = 0;
+	return presetBank.getPresetName(index - numFactoryPresets, presetNumber);
+}
 
+/**
+\brief a preset list entry's value for every dense control (its default where the preset has none)
+
+\return false if out of range
+*/
+bool PluginCore::getPresetControlValues(uint32_t index, double (&values)[kNumDenseControls])
+{
+	for (uint32_t slot = 0; slot < kNumDenseControls; slot++)
+		values[slot] = denseControlParameters[slot] ? denseControlParameters[slot]->getDefaultValue() : 0.0;
+
+	uint32_t numFactoryPresets = (uint32_t)PluginBase::getPresetCount();
+	if (index < numFactoryPresets)
+	{
+		PresetInfo* preset = PluginBase::getPreset(index);
+		if (!preset)
+			return false;
+		for (PresetParameter& parameter : preset->presetParameters)
+		{
+			int32_t slot = getDenseControlSlot((int32_t)parameter.controlID);
+			if (slot >= 0)
+				values[slot] = parameter.actualValue;
+		}
+		return true;
+	}
+
+	uint32_t presetNumber = 0;
+	if (!presetBank.getPresetName(index - numFactoryPresets, presetNumber))
+		return false;
+	const double* bankValues = presetBank.getPresetValues(presetNumber);
+	for (uint32_t column = 0; column < presetBank.getControlCount(); column++)
+	{
+		int32_t slot = getDenseControlSlot(presetBank.getControlID(column));
+		if (slot >= 0)
+			values[slot] = bankValues[column];
+	}
 	return true;
 }
 
@@ -329,9 +926,40 @@ Operation:
 */
 bool PluginCore::preProcessAudioBuffers(ProcessBufferInfo& processInfo)
 {
-    // --- sync internal variables to GUI parameters; you can also do this manually if you don't
-    //     want to use the auto-variable-binding
-    syncInBoundVariables();
+	STAGE_PROFILE_BEGIN(stageProfiler);
+
+    // --- sync internal variables to GUI parameters, but only the ones that changed: every writer
+    //     sets a dirty bit (storeControlValue(), including the direct setPIParamValue() writes, and
+    //     last buffer's smoothing steps), so walk the set bits lowest first instead of
+    //     syncInBoundVariables() - the untouched controls cost nothing
+	// --- new morph presets: swap them in and force the next morph apply
+	if (morphMiddleTable.load(std::memory_order_relaxed) & kMorphTableFresh)
+	{
+		uint32_t middle = morphMiddleTable.exchange(morphReadTable, std::memory_order_acq_rel);
+		morphReadTable = middle & kMorphTableIndexMask;
+		appliedMorph = -1.0;
+		morphStepCountdown = 0;
+	}
+
+	uint64_t dirty = dirtyControls.exchange(0, std::memory_order_acquire) | smoothedControls;
+	smoothedControls = 0;
+	while (dirty)
+	{
+		uint32_t slot = countTrailingZeros64(dirty);
+		dirty &= dirty - 1;
+
+		// --- a write landing after the exchange sets its bit again and syncs next buffer
+		PluginParameter* piParam = denseControlParameters[slot];
+		controlValues.actualValue[slot] = piParam->getControlValue();
+		if (piParam->updateInBoundVariable())
+		{
+			ParameterUpdateInfo paramInfo;
+			paramInfo.boundVariableUpdate = true;
+			postUpdatePluginParameter(piParam->getControlID(), piParam->getControlValue(), paramInfo);
+		}
+		cookControl(piParam->getControlID());
+	}
+	STAGE_PROFILE_LAP(stageProfiler, kStageParameters);
 
     return true;
 }
@@ -353,6 +981,9 @@ bool PluginCore::processAudioFrame(ProcessFrameInfo& processFrameInfo)
     // --- fire any MIDI events for this sample interval
     processFrameInfo.midiEventQueue->fireMidiEvents(processFrameInfo.currentFrame);
 
+	// --- the kernel's frame conversion, MIDI and the last frame's output copy are I/O
+	STAGE_PROFILE_LAP(stageProfiler, kStageIO);
+
 	// --- do per-frame updates; VST automation and parameter smoothing
 	doSampleAccurateParameterUpdates();
 	updateParameters();
@@ -377,6 +1008,7 @@ bool PluginCore::processAudioFrame(ProcessFrameInfo& processFrameInfo)
     {
 		// --- pass through code: change this with your signal processing
         processFrameInfo.audioOutputFrame[0] = processFrameInfo.audioInputFrame[0];
+		telemetry.recordFrame(processFrameInfo.audioOutputFrame[0], processFrameInfo.audioOutputFrame[0]);
 
         return true; /// processed
     }
@@ -388,6 +1020,7 @@ bool PluginCore::processAudioFrame(ProcessFrameInfo& processFrameInfo)
 		// --- pass through code: change this with your signal processing
         processFrameInfo.audioOutputFrame[0] = processFrameInfo.audioInputFrame[0];
         processFrameInfo.audioOutputFrame[1] = processFrameInfo.audioInputFrame[0];
+		telemetry.recordFrame(processFrameInfo.audioOutputFrame[0], processFrameInfo.audioOutputFrame[1]);
 
         return true; /// processed
     }
@@ -399,13 +1032,16 @@ bool PluginCore::processAudioFrame(ProcessFrameInfo& processFrameInfo)
 		// --- pass through code: change this with your signal processing
 		SignalGenData y;
 		y = delayMod.renderAudioOutput();
+		STAGE_PROFILE_LAP(stageProfiler, kStageModulator);
 		double xnR = processFrameInfo.audioInputFrame[0];
 		double xnL = processFrameInfo.audioInputFrame[1];
 		float inputs[2] = { xnR, xnL };
 		float outputs[2] = { 0.0, 0.0 };
 		tapeDelay.processAudioFrame(inputs, outputs, 2, 2);
+		STAGE_PROFILE_LAP(stageProfiler, kStageTapeDelay);
 		processFrameInfo.audioOutputFrame[0] = outputs[0]; // processFrameInfo.audioInputFrame[0];
 		processFrameInfo.audioOutputFrame[1] = outputs[1];// processFrameInfo.audioInputFrame[1];
+		telemetry.recordFrame(outputs[0], outputs[1]);
 
         return true; /// processed
     }
@@ -426,10 +1062,27 @@ Operation:
 */
 bool PluginCore::postProcessAudioBuffers(ProcessBufferInfo& processInfo)
 {
+#if ECHOPLEX_STAGE_PROFILING
+	STAGE_PROFILE_LAP(stageProfiler, kStageIO);
+	stageProfiler.endBuffer(processInfo.numFramesToProcess);
+	loadParameters = stageProfiler.getLoad(kStageParameters);
+	loadModulator = stageProfiler.getLoad(kStageModulator);
+	loadTapeDelay = stageProfiler.getLoad(kStageTapeDelay);
+	loadIO = stageProfiler.getLoad(kStageIO);
+	loadTotal = stageProfiler.getTotalLoad();
+#endif
+
 	// --- update outbound variables; currently this is meter data only, but could be extended
 	//     in the future
 	updateOutBoundVariables();
 
+	// --- smoothing and a moving morph change controls every frame; tell the editor once per buffer
+	while (movedControls)
+	{
+		guiChangeTracker.markChanged(countTrailingZeros64(movedControls));
+		movedControls &= movedControls - 1;
+	}
+
     return true;
 }
 
@@ -448,8 +1101,19 @@ Operation:
 */
 bool PluginCore::updatePluginParameter(int32_t controlID, double controlValue, ParameterUpdateInfo& paramInfo)
 {
-    // --- use base class helper
-    setPIParamValue(controlID, controlValue);
+	// --- a preset load holds the morph like any other restore; moving Morph itself releases it
+	if (paramInfo.loadingPreset)
+		holdPresetMorph();
+	else if (controlID == controlID::presetMorph)
+		morphHeld.store(false, std::memory_order_release);
+
+    // --- dense table instead of the base class map lookup
+	PluginParameter* piParam = getControlParameter(controlID);
+	if (piParam)
+	{
+		piParam->setControlValue(controlValue);
+		storeControlValue(controlID, piParam);
+	}
 
     // --- do any post-processing
     postUpdatePluginParameter(controlID, controlValue, paramInfo);
@@ -472,8 +1136,20 @@ Operation:
 */
 bool PluginCore::updatePluginParameterNormalized(int32_t controlID, double normalizedValue, ParameterUpdateInfo& paramInfo)
 {
-	// --- use base class helper, returns actual value
-	double controlValue = setPIParamValueNormalized(controlID, normalizedValue, paramInfo.applyTaper);
+	// --- a preset load holds the morph like any other restore; moving Morph itself releases it
+	if (paramInfo.loadingPreset)
+		holdPresetMorph();
+	else if (controlID == controlID::presetMorph)
+		morphHeld.store(false, std::memory_order_release);
+
+	// --- dense table instead of the base class map lookup
+	PluginParameter* piParam = getControlParameter(controlID);
+	double controlValue = 0.0;
+	if (piParam)
+	{
+		controlValue = piParam->setControlValueNormalized(normalizedValue, paramInfo.applyTaper);
+		storeControlValue(controlID, piParam);
+	}
 
 	// --- do any post-processing
 	postUpdatePluginParameter(controlID, controlValue, paramInfo);
@@ -481,6 +1157,68 @@ bool PluginCore::updatePluginParameterNormalized(int32_t controlID, double norma
 	return true; /// handled
 }
 
+/**
+\brief flag a control as changed: its bound variable syncs at the top of the next buffer and the
+	   editor redraws it; IDs without a dense slot (SCALE_GUI_SIZE) have no bound variable to
+	   sync and ask the editor for a full resync instead; any thread
+*/
+void PluginCore::storeControlValue(int32_t controlID, PluginParameter* piParam)
+{
+	int32_t slot = getDenseControlSlot(controlID);
+	if (slot < 0)
+	{
+		guiChangeTracker.markAllChanged();
+		return;
+	}
+	dirtyControls.fetch_or(1ull << slot, std::memory_order_release);
+	guiChangeTracker.markChanged((uint32_t)slot);
+}
+
+/**
+\brief direct write to a parameter's actual value, flagged so its bound variable syncs next buffer
+*/
+void PluginCore::setPIParamValue(uint32_t controlID, double actualValue)
+{
+	PluginParameter* piParam = getControlParameter((int32_t)controlID);
+	if (!piParam)
+		return;
+	piParam->setControlValue(actualValue);
+	storeControlValue((int32_t)controlID, piParam);
+}
+
+/**
+\brief direct normalized write, flagged like setPIParamValue()
+
+\return the new actual value, or 0 if there is no such control
+*/
+double PluginCore::setPIParamValueNormalized(uint32_t controlID, double normalizedValue, bool applyTaper)
+{
+	PluginParameter* piParam = getControlParameter((int32_t)controlID);
+	if (!piParam)
+		return 0.0;
+	double actualValue = piParam->setControlValueNormalized(normalizedValue, applyTaper);
+	storeControlValue((int32_t)controlID, piParam);
+	return actualValue;
+}
+
+/**
+\brief per-control cooking that only needs to run when the control changes (called after its bound variable is synced)
+*/
+void PluginCore::cookControl(int32_t controlID)
+{
+	switch (controlID)
+	{
+		case controlID::noiseLevel_dB:
+			noiseLevel_cooked = pow(10.0, noiseLevel_dB / 20.0);
+			break;
+		case controlID::recordLevel_dB:
+			recordLevel_cooked = pow(10.0, recordLevel_dB / 20);
+			break;
+		default:
+			break;
+	}
+}
+
 /**
 \brief perform any operations after the plugin parameter has been updated; this is one paradigm for
 	   transferring control information into vital plugin variables or member objects. If you use this
@@ -496,6 +1234,15 @@ bool PluginCore::updatePluginParameterNormalized(int32_t controlID, double norma
 */
 bool PluginCore::postUpdatePluginParameter(int32_t controlID, double controlValue, ParameterUpdateInfo& paramInfo)
 {
+	// --- a smoothing glide moves the control without storeControlValue(): its slot is synced at the
+	//     top of the next buffer and the editor follows it (stamped once per buffer in postProcessAudioBuffers())
+	int32_t slot = getDenseControlSlot(controlID);
+	if (paramInfo.isSmoothing && slot >= 0)
+	{
+		smoothedControls |= 1ull << slot;
+		movedControls |= 1ull << slot;
+	}
+
     // --- now do any post update cooking; be careful with VST Sample Accurate automation
     //     If enabled, then make sure the cooking functions are short and efficient otherwise disable it
     //     for the Parameter involved
@@ -567,6 +1314,10 @@ bool PluginCore::processMessage(MessageInfo& messageInfo)
 		// --- add customization appearance here
 	case PLUGINGUI_DIDOPEN:
 	{
+		// --- whatever queued while the editor was closed is old news
+		telemetry.discard();
+		guiTelemetry = TelemetryFrame();
+		updateTelemetryMeters();
 		return false;
 	}
 
@@ -579,6 +1330,11 @@ bool PluginCore::processMessage(MessageInfo& messageInfo)
 	// --- update view; this will only be called if the GUI is actually open
 	case PLUGINGUI_TIMERPING:
 	{
+		// --- everything the audio thread queued since the last ping; peaks are held across it,
+		//     and with nothing queued (transport stopped) the peaks fall to zero
+		if (!telemetry.drain(guiTelemetry))
+			guiTelemetry.peak[0] = guiTelemetry.peak[1] = 0.f;
+		updateTelemetryMeters();
 		return false;
 	}
 
@@ -608,6 +1364,28 @@ bool PluginCore::processMessage(MessageInfo& messageInfo)
 }
 
 
+/**
+\brief guiTelemetry -> the telemetry meters (GUI thread)
+
+Out L/R are the linear peaks since the last timer ping; Tape Wow is the modulated delay's
+offset from the Delay Time setting, centred at 0.5 with the modulator's worst case excursion
+at either end.
+*/
+void PluginCore::updateTelemetryMeters()
+{
+	double wow = maxModulationDepth_mSec > 0.0 ? 0.5 + 0.5 * guiTelemetry.wow_mSec / maxModulationDepth_mSec : 0.5;
+	const struct { int32_t id; double value; } meters[] = {
+		{ controlID::outputPeakL, guiTelemetry.peak[0] },
+		{ controlID::outputPeakR, guiTelemetry.peak[1] },
+		{ controlID::tapeWow, wow } };
+	for (const auto& meter : meters)
+	{
+		PluginParameter* piParam = getPluginParameterByControlID(meter.id);
+		if (piParam)
+			piParam->setControlValue(meter.value < 0.0 ? 0.0 : meter.value > 1.0 ? 1.0 : meter.value);
+	}
+}
+
 /**
 \brief process a MIDI event
 
@@ -674,6 +1452,7 @@ bool PluginCore::initPluginPresets()
 	setPresetParameter(preset->presetParameters, controlID::recordLevel_dB, 0.000000);
 	setPresetParameter(preset->presetParameters, controlID::playbackLevel_dB, 0.000000);
 	setPresetParameter(preset->presetParameters, controlID::noiseOutFIlter, 50.000000);
+	setPresetParameter(preset->presetParameters, controlID::presetMorph, 0.000000);
 	addPreset(preset);
 
 	// --- Preset: Noice Bit of Wobble
@@ -692,6 +1471,7 @@ bool PluginCore::initPluginPresets()
 	setPresetParameter(preset->presetParameters, controlID::recordLevel_dB, 0.000000);
 	setPresetParameter(preset->presetParameters, controlID::playbackLevel_dB, 0.000000);
 	setPresetParameter(preset->presetParameters, controlID::noiseOutFIlter, 406.250061);
+	setPresetParameter(preset->presetParameters, controlID::presetMorph, 0.000000);
 	addPreset(preset);
 
 
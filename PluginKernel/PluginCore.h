@@ -15,8 +15,17 @@
 
 #include "pluginbase.h"
 #include "EchoplexDelayModulator.h"
+#include "DSPArena.h"
+#include "PresetBank.h"
+#include "StateChunk.h"
+#include "TelemetryRing.h"
+#include "ControlChangeTracker.h"
+#include "GUIParameterView.h"
+#include "StageProfiler.h"
+#include <atomic>
+#include <mutex>
 #include "fxobjects.h"
-#include "EchoplexTapeDelay.h"
+#include "TapeEchoDelay.h"
 
 // **--0x7F1F--**
 
@@ -35,11 +44,120 @@ enum controlID {
 	noiseLevel_dB = 16,
 	recordLevel_dB = 17,
 	playbackLevel_dB = 18,
-	noiseOutFIlter = 15
+	noiseOutFIlter = 15,
+	presetMorph = 19,
+	loadParameters = 20,
+	loadModulator = 21,
+	loadTapeDelay = 22,
+	loadIO = 23,
+	loadTotal = 24,
+	outputPeakL = 25,
+	outputPeakR = 26,
+	tapeWow = 27,
+	tapeInterpolation = 28
 };
 
 	// **--0x0F1F--**
 
+// --- dense parameter slots: the controlID enum is sparse (0-8, then 15-19), so lookups go
+//     through this compile-time remap into packed arrays instead of the framework's map;
+//     add new controls to kDenseControlIDs - the count and highest ID are derived from it, the
+//     static_assert below catches a duplicate and echoplex_selftest's dense-controls case walks
+//     every registered PluginParameter to catch one missing from the list; the meters (20-27)
+//     are outbound only and have none
+constexpr int32_t kDenseControlIDs[] = {
+	delayTime_ms, noiseFilter_Hz, lowFreqAmp, noiseAmp, noisemodDepth, lfoModDepth, feedBack_pct,
+	wetMix, dryMix, noiseOutFIlter, noiseLevel_dB, recordLevel_dB, playbackLevel_dB, presetMorph,
+	tapeInterpolation };
+
+const uint32_t kNumDenseControls = sizeof(kDenseControlIDs) / sizeof(kDenseControlIDs[0]);
+
+constexpr int32_t getMaxDenseControlID()
+{
+	int32_t maxID = -1;
+	for (uint32_t i = 0; i < kNumDenseControls; i++)
+		maxID = kDenseControlIDs[i] > maxID ? kDenseControlIDs[i] : maxID;
+	return maxID;
+}
+
+const int32_t kMaxDenseControlID = getMaxDenseControlID();
+
+struct DenseControlMap
+{
+	int8_t slot[kMaxDenseControlID + 1];
+};
+
+constexpr DenseControlMap makeDenseControlMap()
+{
+	DenseControlMap map = {};
+	for (int32_t id = 0; id <= kMaxDenseControlID; id++)
+		map.slot[id] = -1;
+	for (uint32_t i = 0; i < kNumDenseControls; i++)
+		if (kDenseControlIDs[i] >= 0)
+			map.slot[kDenseControlIDs[i]] = (int8_t)i;
+	return map;
+}
+
+constexpr DenseControlMap kDenseControlMap = makeDenseControlMap();
+
+/** controlID -> dense slot, or -1 (e.g. SCALE_GUI_SIZE) */
+constexpr int32_t getDenseControlSlot(int32_t id)
+{
+	return (id >= 0 && id <= kMaxDenseControlID) ? kDenseControlMap.slot[id] : -1;
+}
+
+/** no listed ID is negative or listed twice, i.e. every one maps back to its own slot */
+constexpr bool denseControlIDsAreUnique()
+{
+	for (uint32_t i = 0; i < kNumDenseControls; i++)
+		if (getDenseControlSlot(kDenseControlIDs[i]) != (int32_t)i) return false;
+	return true;
+}
+
+static_assert(denseControlIDsAreUnique(), "kDenseControlIDs must list each controlID once, none negative");
+static_assert(kNumDenseControls <= 64, "dirty control bits are a uint64_t");
+
+/** how a control travels between the two morph presets */
+enum class MorphCurve { none, linear, logarithmic, tapeSpeed };
+
+/**
+two presets pre-cooked for morphing: endpoints are stored already transformed into the
+domain they are interpolated in (log for frequencies, 1/delay - tape speed - for the delay
+time), so a morph step is a lerp and an inverse transform per control, no allocation
+*/
+struct PresetMorphTable
+{
+	MorphCurve curve[kNumDenseControls] = { MorphCurve::none };
+	double from[kNumDenseControls] = { 0.0 };
+	double to[kNumDenseControls] = { 0.0 };
+	uint64_t morphed = 0; ///< slots with a curve: all set when a new table is applied
+	uint64_t moving = 0; ///< the morphed slots whose endpoints differ: the only ones a morph step touches
+};
+
+// --- handoff of PresetMorphTables from loadMorphPresets() to the audio thread: a triple buffer, so
+//     neither side ever waits on the other; the writer fills its own table and swaps it into the
+//     middle, the audio thread swaps its own for the middle one when the fresh bit is set
+const uint32_t kMorphTableIndexMask = 3;
+const uint32_t kMorphTableFresh = 4;
+
+/** the morph is evaluated once per this many frames (and once a new table arrives), not every frame */
+const uint32_t kPresetMorphStepFrames = 32;
+
+// --- binary state chunk: header, then tagged sections (see StateChunkWriter); bump the version
+//     only for incompatible payload changes - new data goes in new sections
+const uint32_t kStateChunkMagic = STATECHUNK_TAG('E', 'P', 'S', 'T');
+const uint32_t kStateChunkVersion = 1;
+const uint32_t kStateSectionParameters = STATECHUNK_TAG('P', 'A', 'R', 'M'); ///< uint32 count, { int32 controlID, double actual value }
+const uint32_t kStateSectionModulators = STATECHUNK_TAG('M', 'O', 'D', 'S'); ///< EchoplexModulatorState, field by field
+const uint32_t kStateSectionModulatorComb = STATECHUNK_TAG('M', 'C', 'M', 'B'); ///< EchoplexDelayModulator::saveCombSnapshot()
+const uint32_t kStateSectionTape = STATECHUNK_TAG('T', 'A', 'P', 'E'); ///< TapeEchoDelay::saveSnapshot()
+
+/** packed control values, indexed by dense slot: what each bound variable was last synced to (audio thread) */
+struct DenseControlValues
+{
+	double actualValue[kNumDenseControls] = { 0.0 };
+};
+
 /**
 \class PluginCore
 \ingroup ASPiK-Core
@@ -119,11 +237,112 @@ public:
 	// --- BEGIN USER VARIABLES AND FUNCTIONS -------------------------------------- //
 	//	   Add your variables and methods here
 	EchoplexDelayModulator delayMod;
-	EchoplexTapeDelay tapeDelay;
+	TapeEchoDelay tapeDelay;
 	void updateParameters();
 	double recordLevel_cooked = 0;
 	double playbackLevel_cooked = 0;
 	double noiseLevel_cooked = 0;
+	double tapeDelayCapacity_mSec = 0.0;
+	double tapeDelaySampleRate = 0.0; ///< rate the tape buffers were last sized for
+	void voiceModulator();
+	double getTapeCapacity_mSec();
+	size_t getDelayMemoryBytes();
+	DSPArena dspArena; ///< per-instance, cache aligned home of the tape, the modulator's comb and its noise table; reserved in initialize()
+
+	/** O(1) controlID -> PluginParameter; falls back to the framework map for IDs without a dense slot */
+	inline PluginParameter* getControlParameter(int32_t controlID)
+	{
+		int32_t slot = getDenseControlSlot(controlID);
+		return slot >= 0 ? denseControlParameters[slot] : getPluginParameterByControlID(controlID);
+	}
+
+	/** value a control's bound variable was last synced to (one indexed load); IDs without a slot read their parameter, or 0 if there is none */
+	inline double getControlValue(int32_t controlID)
+	{
+		int32_t slot = getDenseControlSlot(controlID);
+		if (slot >= 0)
+			return controlValues.actualValue[slot];
+		PluginParameter* piParam = getPluginParameterByControlID(controlID);
+		return piParam ? piParam->getControlValue() : 0.0;
+	}
+
+	DenseControlValues controlValues;
+	PluginParameter* denseControlParameters[kNumDenseControls] = { nullptr };
+	void storeControlValue(int32_t controlID, PluginParameter* piParam);
+
+	// --- direct parameter writes, as the API shells' state and preset restores make them: these
+	//     hide the PluginBase versions so every write is flagged like any other change
+	void setPIParamValue(uint32_t controlID, double actualValue);
+	double setPIParamValueNormalized(uint32_t controlID, double normalizedValue, bool applyTaper = true);
+
+	// --- one bit per dense slot, set by every writer (storeControlValue()) and consumed in
+	//     preProcessAudioBuffers; atomic because GUI updates can arrive off the audio thread
+	std::atomic<uint64_t> dirtyControls{ 0 };
+	uint64_t smoothedControls = 0; ///< audio thread: slots a smoothing step moved this buffer, synced at the top of the next
+	void cookControl(int32_t controlID);
+	double playbackLevel_cookedFor_dB = 0.0; ///< playbackLevel_dB is smoothed, so it's cooked when its value moves
+
+	// --- which controls the editor must redraw: stamped in storeControlValue(), and once per buffer
+	//     for controls that smoothing or the morph moved; consumed by the wrapper's timer-ping sync
+	ControlChangeTracker<kNumDenseControls> guiChangeTracker;
+	uint64_t movedControls = 0; ///< audio thread: slots smoothing or applyPresetMorph() moved this buffer
+
+	// --- preset morph: Morph (0..1, smoothed) sweeps every control from morph preset A to B
+	bool loadMorphPresets(uint32_t presetIndexA, uint32_t presetIndexB);
+	void applyPresetMorph(double morph);
+	void holdPresetMorph() { morphHeld.store(true, std::memory_order_release); }
+	PresetMorphTable morphTables[3];
+	uint32_t morphReadTable = 0; ///< audio thread's table
+	uint32_t morphWriteTable = 1; ///< loadMorphPresets()' table, under morphWriterMutex
+	std::atomic<uint32_t> morphMiddleTable{ 2 }; ///< index of the handoff table, | kMorphTableFresh until the audio thread takes it
+	std::mutex morphWriterMutex; ///< serializes writers only; the audio thread never takes it
+	std::atomic<bool> morphHeld{ false }; ///< set by restores: the restored values stand until Morph itself is moved
+	double appliedMorph = -1.0; ///< audio thread: morph value last applied; < 0 forces the next apply (of every morphed slot)
+	uint32_t morphStepCountdown = 0; ///< audio thread: frames until the morph may be evaluated again
+
+	std::string pluginDirectory; ///< folder holding the plugin binary (with trailing separator), from initialize(); empty if unknown
+
+	// --- external preset library: Echoplex.epbk next to the plugin binary, memory-mapped in initialize();
+	//     its presets follow the compiled-in ones in the preset list, served from the mapping on
+	//     demand (these hide the PluginBase versions, which only know the compiled-in list)
+	PresetBank presetBank;
+	size_t getPresetCount() { return PluginBase::getPresetCount() + presetBank.getPresetCount(); }
+	PresetInfo* getPreset(uint32_t index);
+	const char* getPresetName(uint32_t index);
+	bool getPresetControlValues(uint32_t index, double (&values)[kNumDenseControls]);
+	PresetInfo bankPresetInfo{ 0, "" }; ///< getPreset()'s answer for a bank preset, rebuilt per call (main thread)
+	bool applyBankPreset(const char* presetName);
+	bool applyPresetByName(const char* presetName);
+	bool exportPresetBank(const char* path);
+
+	/**
+	read-only view of every parameter (descriptor plus current value), for opening and syncing
+	the editor; built once in initPluginParameters(), so an open copies nothing here
+	*/
+	const GUIParameterView& getGUIParameterView() const { return guiParameterView; }
+	GUIParameterView guiParameterView;
+
+	// --- tape telemetry: output peak/RMS, modulated delay and noise level, pushed wait-free from
+	//     the audio thread and drained into guiTelemetry on PLUGINGUI_TIMERPING, which feeds the
+	//     Out L/R and Tape Wow meters; emptied when the editor opens so it never shows stale blocks
+	TelemetryRecorder telemetry;
+	TelemetryFrame guiTelemetry;
+	void updateTelemetryMeters();
+	double maxModulationDepth_mSec = 0.0; ///< from reset(); full scale of the Tape Wow meter
+
+#if ECHOPLEX_STAGE_PROFILING
+	// --- per-stage cycle counts (ECHOPLEX_STAGE_PROFILING builds only): the load meters and the
+	//     totals echoplex_profile reports; audio thread
+	StageProfiler stageProfiler;
+#endif
+
+	// --- session state: every parameter plus, optionally, the modulators and the tape contents; main thread
+	bool getStateChunk(std::vector<uint8_t>& chunk, bool includeModulators, bool includeTape);
+	bool setStateChunk(const uint8_t* data, size_t size);
+	EchoplexModulatorState pendingModulatorState; ///< from setStateChunk(), applied after the next delayMod.reset()
+	bool hasPendingModulatorState = false;
+	std::vector<uint8_t> pendingDelaySnapshots; ///< comb and tape sections from setStateChunk(), loaded at the end of the next reset()
+	void loadPendingDelaySnapshots();
 	// --- END USER VARIABLES AND FUNCTIONS -------------------------------------- //
 
 private:
@@ -143,7 +362,19 @@ private:
 	double recordLevel_dB = 0.0;
 	double playbackLevel_dB = 0.0;
 	double noiseOutFIlter = 0.0;
-
+	double presetMorph = 0.0;
+
+	// --- Discrete Plugin Variables 
+	int tapeInterpolation = 0;	///< TapeInterpolation, in the order of its string list
+
+#if ECHOPLEX_STAGE_PROFILING
+	// --- Meter Plugin Variables: each stage's share of the real-time budget, last buffer
+	float loadParameters = 0.f;
+	float loadModulator = 0.f;
+	float loadTapeDelay = 0.f;
+	float loadIO = 0.f;
+	float loadTotal = 0.f;
+#endif
 
 	// **--0x1A7F--**
     // --- end member variables
@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef __ControlChangeTracker__
+#define __ControlChangeTracker__
+
+#include <atomic>
+#include <cstdint>
+
+/**
+\class ControlChangeTracker
+\ingroup FX-Objects
+\brief
+Tells an editor which controls changed since it last looked, so a timer ping repaints those
+and nothing else, and paces the pings themselves: every ping while something is moving, every
+kIdleDivider-th ping once nothing has changed for kIdlePings pings.
+
+Producers (any thread) call markChanged(slot): one fetch_add on a shared sequence counter and
+a store of the stamp into the slot. The consumer (the GUI thread) keeps the last stamp it saw
+per slot and compares - no global ordering is needed, so a stamp that becomes visible late is
+picked up on the next ping rather than lost.
+
+A change that has no slot (a parameter outside the tracked set) goes through markAllChanged();
+the consumer sees it from takeFullSync() and redraws everything once.
+
+\version Revision : 1.1
+\date Date : 2019 / 01 / 31
+*/
+template <uint32_t NUM_SLOTS>
+class ControlChangeTracker
+{
+public:
+	static const uint32_t kIdlePings = 30;		///< quiet pings before slowing down
+	static const uint32_t kIdleDivider = 4;		///< when idle, sync on every kIdleDivider-th ping
+
+	ControlChangeTracker()	/* C-TOR */
+	{
+		for (uint32_t i = 0; i < NUM_SLOTS; i++)
+			changedAt[i].store(0, std::memory_order_relaxed);
+	}
+
+	/** producer side: any thread, never blocks */
+	inline void markChanged(uint32_t slot)
+	{
+		uint64_t stamp = sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+		changedAt[slot].store(stamp, std::memory_order_release);
+	}
+
+	/** producer side: something without a slot changed; the next ping redraws every control */
+	inline void markAllChanged()
+	{
+		sequence.fetch_add(1, std::memory_order_relaxed);
+		fullSyncRequested.store(true, std::memory_order_release);
+	}
+
+	/** consumer side: true (once) if markAllChanged() was called since the last take; the caller redraws everything, then calls markAllSynced() */
+	bool takeFullSync()
+	{
+		return fullSyncRequested.exchange(false, std::memory_order_acq_rel);
+	}
+
+	/** consumer side: the editor was just built from the current values - nothing is stale */
+	void markAllSynced()
+	{
+		for (uint32_t i = 0; i < NUM_SLOTS; i++)
+			lastSeen[i] = changedAt[i].load(std::memory_order_acquire);
+		lastSequence = sequence.load(std::memory_order_relaxed);
+		quietPings = 0;
+		pingCount = 0;
+	}
+
+	/**
+	consumer side, once per timer ping: calls syncSlot(slot) for every slot changed since the
+	last call, unless the idle pacing skips this ping
+
+	\return number of slots synced
+	*/
+	template <typename SyncFunction>
+	uint32_t syncChanged(SyncFunction syncSlot)
+	{
+		// --- activity since the last ping keeps us at the full rate
+		uint64_t now = sequence.load(std::memory_order_relaxed);
+		if (now != lastSequence)
+		{
+			lastSequence = now;
+			quietPings = 0;
+		}
+		else if (quietPings < kIdlePings)
+			quietPings++;
+
+		pingCount++;
+		if (quietPings >= kIdlePings && (pingCount % kIdleDivider) != 0)
+			return 0;
+
+		uint32_t synced = 0;
+		for (uint32_t i = 0; i < NUM_SLOTS; i++)
+		{
+			uint64_t stamp = changedAt[i].load(std::memory_order_acquire);
+			if (stamp == lastSeen[i])
+				continue;
+			lastSeen[i] = stamp;
+			syncSlot(i);
+			synced++;
+		}
+		return synced;
+	}
+
+	/** true once the idle pacing has kicked in */
+	bool isIdle() const { return quietPings >= kIdlePings; }
+
+private:
+	std::atomic<uint64_t> sequence{ 0 };
+	std::atomic<uint64_t> changedAt[NUM_SLOTS];
+	std::atomic<bool> fullSyncRequested{ false };
+
+	// --- consumer (GUI thread) state
+	uint64_t lastSeen[NUM_SLOTS] = { 0 };
+	uint64_t lastSequence = 0;
+	uint32_t quietPings = 0;
+	uint32_t pingCount = 0;
+};
+
+#endif
@@ -0,0 +1,135 @@
+// -----------------------------------------------------------------------------
+//    Echoplex DSP arena:  DSPArena.cpp
+//
+/**
+    \file   DSPArena.cpp
+    \brief  the OS side of DSPArena: VirtualAlloc/mmap, huge pages (asked for and actual) and
+    		page size; kept out of DSPArena.h so <windows.h> doesn't reach every file that
+    		includes PluginCore.h
+*/
+// -----------------------------------------------------------------------------
+#include "DSPArena.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool DSPArena::reserve(size_t bytes, bool useHugePages)
+{
+	release();
+	if (bytes == 0)
+		return true;
+
+	size_t pageSize = getPageSize();
+	capacity = roundUp(bytes, pageSize);
+
+#if defined(_WIN32)
+	if (useHugePages)
+	{
+		size_t largePage = GetLargePageMinimum();
+		if (largePage > 0)
+		{
+			size_t largeCapacity = roundUp(bytes, largePage);
+			block = (uint8_t*)VirtualAlloc(nullptr, largeCapacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (block)
+			{
+				capacity = largeCapacity;
+				hugePagesRequested = true;
+			}
+		}
+	}
+	if (!block)
+		block = (uint8_t*)VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	block = memory == MAP_FAILED ? nullptr : (uint8_t*)memory;
+#ifdef MADV_HUGEPAGE
+	// --- advisory: transparent huge pages, if the kernel has them enabled
+	if (block && useHugePages)
+		hugePagesRequested = madvise(block, capacity, MADV_HUGEPAGE) == 0;
+#endif
+#endif
+	if (!block)
+	{
+		capacity = 0;
+		return false;
+	}
+
+	// --- pre-fault: touch every page now rather than in the first process call
+	memset(block, 0, capacity);
+	return true;
+}
+
+void DSPArena::release()
+{
+	if (block)
+	{
+#if defined(_WIN32)
+		VirtualFree(block, 0, MEM_RELEASE);
+#else
+		munmap(block, capacity);
+#endif
+	}
+	block = nullptr;
+	capacity = 0;
+	used = 0;
+	hugePagesRequested = false;
+	layout.clear();
+}
+
+size_t DSPArena::getHugePageBytes() const
+{
+	if (!block || !hugePagesRequested)
+		return 0;
+#if defined(_WIN32)
+	// --- MEM_LARGE_PAGES either maps the whole block on large pages or fails
+	return capacity;
+#elif defined(__linux__)
+	// --- the smaps entry of the mapping holding the block; the kernel may have merged it with a
+	//     neighbouring anonymous mapping, so the figure is capped at the block size
+	FILE* smaps = fopen("/proc/self/smaps", "r");
+	if (!smaps)
+		return 0;
+	uintptr_t address = (uintptr_t)block;
+	bool inBlock = false;
+	size_t hugeBytes = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), smaps))
+	{
+		unsigned long long start = 0, end = 0;
+		unsigned long long kiloBytes = 0;
+		if (sscanf(line, "%llx-%llx ", &start, &end) == 2)
+		{
+			if (inBlock)
+				break;
+			inBlock = address >= start && address < end;
+		}
+		else if (inBlock && sscanf(line, "AnonHugePages: %llu kB", &kiloBytes) == 1)
+		{
+			hugeBytes = (size_t)kiloBytes * 1024;
+			break;
+		}
+	}
+	fclose(smaps);
+	return hugeBytes < capacity ? hugeBytes : capacity;
+#else
+	return 0;
+#endif
+}
+
+size_t DSPArena::getPageSize()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#ifndef __DSPArena__
+#define __DSPArena__
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/** arenas are laid out once for this rate; lower rates use a prefix of each region */
+const double kDSPArenaMaxSampleRate = 192000.0;
+
+/**
+\brief zero only the part of a power-of-two ring written since the last clear
+
+Touches min(samplesWritten, ringLength) frames ending just before writeIndex, wrapping as
+needed, instead of the whole ring - after a short run the clear costs next to nothing.
+
+\param ring ring buffer
+\param ringLength length in frames (power of two)
+\param writeIndex next frame to be written
+\param samplesWritten frames written since the last clear
+\param frameSize Ts per frame (2 for interleaved stereo)
+*/
+template <typename T>
+inline void clearWrittenRegion(T* ring, uint32_t ringLength, uint32_t writeIndex, uint64_t samplesWritten, uint32_t frameSize = 1)
+{
+	if (!ring || samplesWritten == 0)
+		return;
+	if (samplesWritten >= ringLength)
+	{
+		memset(ring, 0, (size_t)ringLength * frameSize * sizeof(T));
+		return;
+	}
+	uint32_t dirty = (uint32_t)samplesWritten;
+	uint32_t start = (writeIndex - dirty) & (ringLength - 1);
+	uint32_t first = dirty < ringLength - start ? dirty : ringLength - start;
+	memset(ring + (size_t)start * frameSize, 0, (size_t)first * frameSize * sizeof(T));
+	memset(ring, 0, (size_t)(dirty - first) * frameSize * sizeof(T));
+}
+
+/**
+\class DSPArena
+\ingroup FX-Objects
+\brief
+One block of memory per plugin instance for the delay lines and tables of the objects that
+take a region - today the tape (TapeEchoDelay's StereoTapeBuffer), the scalloping comb
+(UCombFilter) and a per-instance drift noise table - carved up with a bump allocator at
+initialize() time and never freed or moved until the arena dies.
+
+- every region starts on a 64 byte (cache line) boundary
+- the block comes straight from the OS (VirtualAlloc/mmap), optionally huge-page backed;
+  if huge pages aren't available (no SeLockMemoryPrivilege on Windows, THP off on Linux)
+  it quietly uses normal pages. On Linux madvise() only asks: getHugePageBytes() reports what
+  the kernel actually backed (AnonHugePages in /proc/self/smaps)
+- reserve() pre-faults the whole block by writing it, so the first audio callback after
+  reset() never takes a page fault
+- getLayoutReport() lists every region (name, offset, size) for inspection
+
+Objects size themselves for kDSPArenaMaxSampleRate and take their region in attachArena();
+if an object needs more than its region at reset time it falls back to its own heap buffer.
+
+Not thread safe: reserve/allocate on the main thread, before audio runs. The OS calls live in
+DSPArena.cpp so no platform header leaks into the plugin's headers.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class DSPArena
+{
+public:
+	DSPArena(void) {}	/* C-TOR */
+	~DSPArena(void) { release(); }	/* D-TOR */
+
+	DSPArena(const DSPArena&) = delete;
+	DSPArena& operator=(const DSPArena&) = delete;
+
+	static const size_t kAlignment = 64;
+
+	/** reserve and pre-fault the block; drops any previous block and its layout (DSPArena.cpp) */
+	bool reserve(size_t bytes, bool useHugePages);
+
+	/** cache line aligned region of count Ts, zeroed; nullptr if the arena is full (caller falls back to the heap) */
+	template <typename T>
+	T* allocate(size_t count, const char* name)
+	{
+		size_t offset = roundUp(used, kAlignment);
+		size_t bytes = count * sizeof(T);
+		if (!block || offset + bytes > capacity)
+			return nullptr;
+
+		used = offset + bytes;
+		layout.push_back({ name, offset, bytes });
+		return (T*)(block + offset);
+	}
+
+	/** forget the layout but keep the block (pre-faulted pages stay resident) */
+	void clearLayout()
+	{
+		used = 0;
+		layout.clear();
+	}
+
+	size_t getCapacity() const { return capacity; }
+	size_t getUsedBytes() const { return used; }
+
+	/** huge pages were asked for and the OS took the request (granted on Windows, advised on Linux) */
+	bool isHugePageRequested() const { return hugePagesRequested; }
+
+	/** bytes of the block on huge pages right now (DSPArena.cpp) */
+	size_t getHugePageBytes() const;
+	bool isHugePageBacked() const { return getHugePageBytes() > 0; }
+
+	/** one line per region plus a summary */
+	std::string getLayoutReport() const
+	{
+		std::string report;
+		char line[256];
+		for (const Region& region : layout)
+		{
+			snprintf(line, sizeof(line), "%10zu  %10zu  %s\n", region.offset, region.bytes, region.name.c_str());
+			report += line;
+		}
+		snprintf(line, sizeof(line), "used %zu of %zu bytes, huge pages %s, %zu bytes on huge pages\n", used, capacity,
+			hugePagesRequested ? "requested" : "not requested", getHugePageBytes());
+		report += line;
+		return report;
+	}
+
+	/** round up to the next multiple of a power of two */
+	static size_t roundUp(size_t value, size_t multiple) { return (value + multiple - 1) & ~(multiple - 1); }
+
+	/** bytes one aligned region of count Ts takes; use this when summing up a reserve() size */
+	template <typename T>
+	static size_t regionBytes(size_t count) { return roundUp(count * sizeof(T), kAlignment); }
+
+private:
+	struct Region
+	{
+		std::string name;
+		size_t offset;
+		size_t bytes;
+	};
+
+	/** give the block back to the OS (DSPArena.cpp) */
+	void release();
+
+	static size_t getPageSize();
+
+	uint8_t* block = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+	bool hugePagesRequested = false;
+	std::vector<Region> layout;
+};
+
+#endif
@@ -8,6 +8,19 @@
 #include "UniversalComb.h"
 #include "SystemNoiseGen.h"
 
+/**
+\struct EchoplexModulatorState
+\ingroup FX-Objects
+\brief
+Where the modulators are in their cycles. reset() randomizes these (so instances drift
+apart); saving and restoring them brings a recalled session back with the same wow and flutter.
+*/
+struct EchoplexModulatorState
+{
+	double lfoPhase[3] = { 0.0, 0.0, 0.0 };
+	SystemNoiseGenState noise;
+};
+
 /**
 \struct EchoplexDelayModulatorParameters
 \ingroup FX-Objects
@@ -46,6 +59,10 @@ struct EchoplexDelayModulatorParameters
 		delayTime = params.delayTime;
 		noiseSaturation = params.noiseSaturation;
 		sixtyHzNoiseAmp = params.sixtyHzNoiseAmp;
+		noiseColour = params.noiseColour;
+		noiseTableMode = params.noiseTableMode;
+		mainsFrequency = params.mainsFrequency;
+		humHarmonics = params.humHarmonics;
 		// --- MUST be last
 		return *this;
 	}
@@ -63,6 +80,10 @@ struct EchoplexDelayModulatorParameters
 	double noiseSaturation = 1.0;
 	double sixtyHzNoiseAmp = 0.5;
 	double noiseOut = 1.0;
+	NoiseColour noiseColour = NoiseColour::gaussian; ///< colour of the low frequency drift noise
+	NoiseTableMode noiseTableMode = NoiseTableMode::off; ///< pre-rendered drift noise; takes effect on reset
+	MainsFrequency mainsFrequency = MainsFrequency::sixtyHz; ///< hum fundamental
+	double humHarmonics = 0.0; ///< [0, 1] harmonic content of the hum
 };
 
 
@@ -102,11 +123,15 @@ public:
 			Tparams.lfoFrequency_Hz[i] = parameters.lfoFrequency_Hz[i];
 			capstanPinchModulator.setParameters(Tparams);
 		}
-		scallopingFilter.reset(sampleRate);
+		// --- the comb only ever sees the scalloping range; don't allocate more than that
 		UCombFilterParameters combparams = scallopingFilter.getParameters();
 		combparams.combFilterType = CombFilterType::inverseCombFilter;
+		combparams.maxDelayTime_mSec = kScallopingMax_mSec;
 		scallopingFilter.setParameters(combparams);
+		scallopingFilter.reset(sampleRate);
 
+		// --- the drift noise table is built in reset, so it needs the current settings first
+		updateDriftModulatorParameters();
 		lfDriftModulator.reset(sampleRate);
 
 		// --- do any other per-audio-run inits here
@@ -150,30 +175,126 @@ public:
 		//     and copy the variables one at a time, or you may test
 		//     to see if cook-able variables have changed; if not, then
 		//     do not re-cook them as it just wastes CPU
+		parameters = _params;
+
 		TrippleLFOParameters TparamsAF = capstanPinchModulator.getParameters();
 		for (int i = 0; i < 3; i++) {
 			TparamsAF.lfoAmplitude[i] = parameters.lfoAmplitude[i];
 			capstanPinchModulator.setParameters(TparamsAF);
 		}
-		SystemNoiseGenParameters noiseparams = lfDriftModulator.getParameters();
-		noiseparams.tapeNoiseFc_Hz = parameters.noiseFilterFc_Hz;
-		noiseparams.tapeNoiseAmplitude = parameters.noiseFilterAmplitude;
-		noiseparams.sixtyHzNoiseAmplitude = parameters.sixtyHzNoiseAmp;
-		noiseparams.waveshaperSaturation = parameters.noiseSaturation;
-		lfDriftModulator.setParameters(noiseparams);
+		updateDriftModulatorParameters();
 
 		double mappedValue = parameters.delayTime;
-		// --- call the mapping function
-		mappedValue = mapDoubleValue(mappedValue, 90.0, 680.0, 0.5, 5.0);
+		// --- call the mapping function; it bounds to the scalloping range, so the comb never sees a negative delay
+		mappedValue = mapDoubleValue(mappedValue, kDelayTimeMin_mSec, kDelayTimeMax_mSec, kScallopingMin_mSec, kScallopingMax_mSec);
 		UCombFilterParameters ucombparamsAF = scallopingFilter.getParameters();
 		ucombparamsAF.delayTime_mSec = mappedValue;
 		scallopingFilter.setParameters(ucombparamsAF);
+	}
 
-		parameters = _params;
+	/** bytes held by delay lines */
+	size_t getDelayMemoryBytes()
+	{
+		return scallopingFilter.getDelayMemoryBytes();
+	}
+
+	/**
+	worst case excursion of renderAudioOutput() around delayTime, in mSec, for the current noise
+	and hum settings, delayTime up to maxDelayTime_mSec and LFO depth up to maxLfoDepth_Pct.
+
+	Each term is its source's peak times doBipolarModulation's +/-5 * min(1, peak * depth), and the
+	scalloping comb's dry + wet gains bound what it passes on. The drift peak is the shaped hum plus
+	the filtered noise; gaussian noise has no peak so it is taken at kNoiseCrestFactor sigma, and the
+	2nd order Butterworth low pass gains at most kLowPassPeakGain on a bounded input. The capstan
+	LFOs (2.5 Hz and up) pass the 0.01 Hz high pass at unity.
+	*/
+	double getMaxModulationDepth_mSec(double maxDelayTime_mSec, double maxLfoDepth_Pct)
+	{
+		double noiseSourcePeak = parameters.noiseColour == NoiseColour::gaussian ? kNoiseCrestFactor : 1.0;
+		double noisePeak = noiseSourcePeak * kLowPassPeakGain * fabs(parameters.noiseFilterAmplitude);
+		double humPeak = fabs(atanWaveShaper(parameters.sixtyHzNoiseAmp, parameters.noiseSaturation));
+		double driftPeak = humPeak + noisePeak;
+		double driftDepth = fabs(parameters.noiseDepth_Pct / 100 * calculateDriftDepth(normalizeValue(maxDelayTime_mSec, kDelayTimeMin_mSec, kDelayTimeMax_mSec)));
+
+		double capstanPeak = 0.0;
+		for (int i = 0; i < 3; i++)
+			capstanPeak += 0.33 * fabs(parameters.lfoAmplitude[i]);
+		capstanPeak *= fabs(capstanPinchModulator.getParameters().outputAmplitude);
+		double capstanDepth = fabs(maxLfoDepth_Pct / 100);
+
+		UCombFilterParameters combparams = scallopingFilter.getParameters();
+		double combGain = fabs(combparams.dryGain) + fabs(combparams.wetGain);
+
+		double excursion = 5.0 * driftPeak * fmin(1.0, driftPeak * driftDepth) +
+						   5.0 * capstanPeak * fmin(1.0, capstanPeak * capstanDepth);
+		return combGain * excursion;
+	}
+
+	/** arena bytes attachArena() will take; a query, it doesn't push any settings down */
+	size_t getArenaBytes(double maxSampleRate)
+	{
+		return UCombFilter::getArenaBytes(maxSampleRate, kScallopingMax_mSec) +
+			   SystemNoiseGen::getArenaBytes(maxSampleRate, getDriftModulatorParameters());
+	}
 
+	/** carve the comb and (per-instance) drift noise table out of the arena; call before reset() */
+	void attachArena(DSPArena& arena, double maxSampleRate)
+	{
+		updateDriftModulatorParameters();
+		scallopingFilter.attachArena(arena, maxSampleRate, kScallopingMax_mSec);
+		lfDriftModulator.attachArena(arena, maxSampleRate);
+	}
+
+	/** LFO and noise positions, for state save */
+	EchoplexModulatorState getModulatorState()
+	{
+		EchoplexModulatorState state;
+		capstanPinchModulator.getPhases(state.lfoPhase);
+		state.noise = lfDriftModulator.getState();
+		return state;
+	}
+
+	/** restore positions; call after reset(), which would otherwise randomize them again */
+	void setModulatorState(const EchoplexModulatorState& state)
+	{
+		capstanPinchModulator.setPhases(state.lfoPhase);
+		lfDriftModulator.setState(state.noise);
+	}
+
+	/** the scalloping comb's memory, so a restored modulator continues rather than restarting from silence */
+	void saveCombSnapshot(StateChunkWriter& writer) { scallopingFilter.saveSnapshot(writer); }
+
+	/** call after reset(), which clears the comb */
+	bool loadCombSnapshot(StateChunkReader& reader) { return scallopingFilter.loadSnapshot(reader); }
+
+	/** bytes held by the drift modulator's noise table (0 when rendering live) */
+	size_t getNoiseTableMemoryBytes()
+	{
+		return lfDriftModulator.getNoiseTableMemoryBytes();
 	}
 
 protected:
+	/** our noise settings, as the drift modulator's parameters */
+	SystemNoiseGenParameters getDriftModulatorParameters()
+	{
+		SystemNoiseGenParameters noiseparams = lfDriftModulator.getParameters();
+		noiseparams.tapeNoiseFc_Hz = parameters.noiseFilterFc_Hz;
+		noiseparams.tapeNoiseAmplitude = parameters.noiseFilterAmplitude;
+		noiseparams.sixtyHzNoiseAmplitude = parameters.sixtyHzNoiseAmp;
+		noiseparams.waveshaperSaturation = parameters.noiseSaturation;
+		noiseparams.noiseColour = parameters.noiseColour;
+		noiseparams.noiseTableMode = parameters.noiseTableMode;
+		noiseparams.mainsFrequency = parameters.mainsFrequency;
+		noiseparams.humHarmonics = parameters.humHarmonics;
+		return noiseparams;
+	}
+
+	/** push our noise settings down to the drift modulator */
+	void updateDriftModulatorParameters()
+	{
+		lfDriftModulator.setParameters(getDriftModulatorParameters());
+	}
+
 	double calculateDriftDepth(double normalizedDelayTime)
 	{
 		double y = 1 - 4.646429 * normalizedDelayTime + 7.767857 * normalizedDelayTime;
@@ -186,9 +307,23 @@ protected:
 	}
 
 	double mapDoubleValue(double mapped, double minIn, double maxIn, double minOut, double maxOut) {
-		return (mapped) / (maxIn / (maxOut - minIn)) + minOut;
+		double normalized = (mapped - minIn) / (maxIn - minIn);
+		boundValue(normalized, 0.0, 1.0);
+		return minOut + normalized * (maxOut - minOut);
 	}
 
+	// --- delayTime range (the plugin's Delay Time control) and the scalloping comb range it maps to
+	static constexpr double kDelayTimeMin_mSec = 90.0;
+	static constexpr double kDelayTimeMax_mSec = 680.0;
+	static constexpr double kScallopingMin_mSec = 0.5;
+	static constexpr double kScallopingMax_mSec = 5.0;
+
+	// --- for getMaxModulationDepth_mSec(): the gaussian noise peak in sigmas (exceeded about once in
+	//     5 x 10^8 samples, before the filter narrows it) and the L1 norm of the kButterLPF2 impulse
+	//     response, which is its largest gain on a bounded input
+	static constexpr double kNoiseCrestFactor = 6.0;
+	static constexpr double kLowPassPeakGain = 1.1;
+
 private:
 	EchoplexDelayModulatorParameters parameters; ///< object parameters
 	// --- generates the three LFOs
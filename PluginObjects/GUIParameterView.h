@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef __GUIParameterView__
+#define __GUIParameterView__
+
+#include "pluginparameter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+\struct GUIParameterDescriptor
+\ingroup FX-Objects
+\brief
+What an editor needs to build a control for a parameter, none of which changes after the
+parameter is created. The strings point into the PluginParameter itself.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+struct GUIParameterDescriptor
+{
+	uint32_t controlID = 0;
+	const char* name = "";
+	const char* units = "";
+	const char* stringList = "";	///< comma separated, for string list (option menu) controls
+	controlVariableType variableType = controlVariableType::kDouble;
+	double minValue = 0.0;
+	double maxValue = 1.0;
+	double defaultValue = 0.0;
+};
+
+/**
+\class GUIParameterView
+\ingroup FX-Objects
+\brief
+Read-only view of a plugin's parameters for building and syncing an editor: a descriptor per
+parameter, in creation order, taken once when the parameters are created, a lookup by control
+ID for the controls an editor creates from its tags, and the current values read straight
+from the live parameters. Opening an editor copies nothing.
+
+PluginParameter's getters aren't const, so the view keeps the parameters to itself and hands
+out only descriptors and values. build() on the main thread, before any editor opens; the
+parameters must outlive the view. getParameterList() is the same parameters in the form
+PluginGUI::open() takes.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class GUIParameterView
+{
+public:
+	GUIParameterView(void) {}	/* C-TOR */
+	~GUIParameterView(void) {}	/* D-TOR */
+
+	/** take the parameters in creation order */
+	void build(PluginParameter* const* parameters, uint32_t count)
+	{
+		parameterList.assign(parameters, parameters + count);
+		descriptors.resize(count);
+		byControlID.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			PluginParameter* parameter = parameters[i];
+			GUIParameterDescriptor& descriptor = descriptors[i];
+			descriptor.controlID = parameter->getControlID();
+			descriptor.name = parameter->getControlName();
+			descriptor.units = parameter->getControlUnits();
+			descriptor.stringList = parameter->getCommaSeparatedStringList();
+			descriptor.variableType = parameter->getControlVariableType();
+			descriptor.minValue = parameter->getMinValue();
+			descriptor.maxValue = parameter->getMaxValue();
+			descriptor.defaultValue = parameter->getDefaultValue();
+			byControlID[i] = i;
+		}
+		std::sort(byControlID.begin(), byControlID.end(),
+			[this](uint32_t a, uint32_t b) { return descriptors[a].controlID < descriptors[b].controlID; });
+	}
+
+	uint32_t size() const { return (uint32_t)descriptors.size(); }
+
+	/** the index-th parameter's descriptor, in creation order */
+	const GUIParameterDescriptor& getDescriptor(uint32_t index) const { return descriptors[index]; }
+
+	/** index of the parameter behind a control tag; -1 for tags that aren't parameters (custom views) */
+	int32_t findIndex(uint32_t controlID) const
+	{
+		auto entry = std::lower_bound(byControlID.begin(), byControlID.end(), controlID,
+			[this](uint32_t index, uint32_t id) { return descriptors[index].controlID < id; });
+		return entry != byControlID.end() && descriptors[*entry].controlID == controlID ? (int32_t)*entry : -1;
+	}
+
+	/** current value, plain and as the control shows it */
+	double getValue(uint32_t index) const { return parameterList[index]->getControlValue(); }
+	double getValueNormalized(uint32_t index) const { return parameterList[index]->getControlValueNormalized(); }
+
+	/** for PluginGUI::open(), which takes a vector of pointers */
+	const std::vector<PluginParameter*>* getParameterList() const { return &parameterList; }
+
+private:
+	std::vector<PluginParameter*> parameterList;		///< creation order
+	std::vector<GUIParameterDescriptor> descriptors;	///< creation order
+	std::vector<uint32_t> byControlID;					///< indices, sorted by control ID
+};
+
+#endif
@@ -175,6 +175,21 @@ public:
 		// --- cook parameters here
 	}
 
+	/**
+	current position in the cycle [0, 1); for state save/restore. renderAudioOutput() advances the
+	counter after it wraps it, so between renders it can sit at or past 1.0: that is the same place
+	as counter - 1.0, which setPhase() keeps as is and the next render reads unchanged
+	*/
+	double getPhase() { return modCounter >= 1.0 ? modCounter - 1.0 : modCounter; }
+
+	/** jump to a position in the cycle; the quad phase output follows on the next render */
+	void setPhase(double phase)
+	{
+		modCounter = phase - floor(phase);
+		modCounterQP = modCounter;
+		advanceAndCheckWrapModulo(modCounterQP, 0.25);
+	}
+
 private:
 	LFO_ExParameters Exparameters; ///< object parameters
 
@@ -0,0 +1,208 @@
+#pragma once
+
+#ifndef __NoiseLoopTable__
+#define __NoiseLoopTable__
+
+#include "fxobjects.h"
+#include "noisegen.h"
+#include "DSPArena.h"
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+/** how SystemNoiseGen gets its drift noise: rendered live, from a table built at reset, or from a process-wide shared table */
+enum class NoiseTableMode { off, perInstance, shared };
+
+/**
+\class NoiseLoopTable
+\ingroup FX-Objects
+\brief
+A long, pre-filtered, seamlessly looping noise table. Readers keep their own offset and
+direction so many instances can share one read-only table; the per-sample cost is one load
+and one multiply.
+
+The table is filtered with the same 2nd order Butterworth LPF NoiseGenerator uses, run twice
+around the loop so the filter state at the end matches the start and the wrap is click-free.
+Length is rounded up to a power of two so the read index wraps with a mask.
+
+Readers only step by +1 or -1: reversed noise has the same magnitude spectrum, whereas a
+larger stride would widen the noise bandwidth by the stride factor.
+
+Use getShared() from reset() only - it allocates and takes a lock. Per-instance tables can
+render into caller-owned storage (a DSPArena region) instead of allocating their own.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class NoiseLoopTable
+{
+public:
+	/** storage is optional: used if it holds at least getRequiredLength() floats, otherwise the table allocates its own */
+	NoiseLoopTable(double _sampleRate, double _lpf_fc_Hz, NoiseColour _colour, double _length_Sec, uint32_t seed,
+		float* storage = nullptr, uint32_t storageLength = 0)
+		: sampleRate(_sampleRate), lpf_fc_Hz(_lpf_fc_Hz), colour(_colour), length_Sec(_length_Sec)
+	{
+		length = getRequiredLength(_sampleRate, _length_Sec);
+		wrapMask = length - 1;
+		if (storage && storageLength >= length)
+			table = storage;
+		else
+		{
+			ownedTable.reset(new float[length]);
+			table = ownedTable.get();
+		}
+
+		// --- raw source
+		std::vector<double> raw(length);
+		if (colour == NoiseColour::pink)
+		{
+			PinkNoise pink;
+			pink.reset(seed);
+			pink.renderBlock(&raw[0], length);
+		}
+		else if (colour == NoiseColour::white)
+		{
+			std::mt19937 engine(seed);
+			std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+			for (uint32_t i = 0; i < length; i++)
+				raw[i] = uniform(engine);
+		}
+		else
+		{
+			std::mt19937 engine(seed);
+			std::normal_distribution<double> normal(0.0, 1.0);
+			for (uint32_t i = 0; i < length; i++)
+				raw[i] = normal(engine);
+		}
+
+		// --- filter twice around the loop; the second pass starts from the end-of-loop state
+		AudioFilter lowPassFilter;
+		AudioFilterParameters params = lowPassFilter.getParameters();
+		params.algorithm = filterAlgorithm::kButterLPF2;
+		params.fc = _lpf_fc_Hz;
+		lowPassFilter.setParameters(params);
+		lowPassFilter.reset(_sampleRate);
+		for (uint32_t i = 0; i < length; i++)
+			lowPassFilter.processAudioSample(raw[i]);
+		for (uint32_t i = 0; i < length; i++)
+			table[i] = (float)lowPassFilter.processAudioSample(raw[i]);
+	}
+
+	/** find or build a table shared by every instance in the process with the same settings */
+	static std::shared_ptr<const NoiseLoopTable> getShared(double _sampleRate, double _lpf_fc_Hz, NoiseColour _colour, double _length_Sec)
+	{
+		std::lock_guard<std::mutex> lock(getCacheMutex());
+		std::vector<std::weak_ptr<const NoiseLoopTable>>& cache = getCache();
+
+		for (size_t i = 0; i < cache.size(); )
+		{
+			std::shared_ptr<const NoiseLoopTable> existing = cache[i].lock();
+			if (!existing)
+			{
+				// --- nobody uses it any more
+				cache.erase(cache.begin() + i);
+				continue;
+			}
+			if (existing->matches(_sampleRate, _lpf_fc_Hz, _colour, _length_Sec))
+				return existing;
+			i++;
+		}
+
+		std::shared_ptr<const NoiseLoopTable> table = std::make_shared<const NoiseLoopTable>(_sampleRate, _lpf_fc_Hz, _colour, _length_Sec, 0x2545F491u);
+		cache.push_back(table);
+		return table;
+	}
+
+	/** bytes held by all live shared tables */
+	static size_t getSharedMemoryBytes()
+	{
+		std::lock_guard<std::mutex> lock(getCacheMutex());
+		size_t bytes = 0;
+		for (auto& entry : getCache())
+		{
+			std::shared_ptr<const NoiseLoopTable> existing = entry.lock();
+			if (existing)
+				bytes += existing->getMemoryBytes();
+		}
+		return bytes;
+	}
+
+	/** table length (power of two) for a rate and minimum loop length */
+	static uint32_t getRequiredLength(double _sampleRate, double _length_Sec)
+	{
+		uint32_t minLength = (uint32_t)(_length_Sec * _sampleRate) + 1;
+		uint32_t tableLength = 1;
+		while (tableLength < minLength)
+			tableLength <<= 1;
+		return tableLength;
+	}
+
+	bool matches(double _sampleRate, double _lpf_fc_Hz, NoiseColour _colour, double _length_Sec) const
+	{
+		return sampleRate == _sampleRate && lpf_fc_Hz == _lpf_fc_Hz && colour == _colour && length_Sec == _length_Sec;
+	}
+
+	inline float read(uint32_t index) const { return table[index & wrapMask]; }
+	uint32_t getLength() const { return length; }
+	uint32_t getWrapMask() const { return wrapMask; }
+	size_t getMemoryBytes() const { return length * sizeof(float); }
+
+	/**
+	Looping check: the largest normalized cross correlation between two readers started at
+	different offsets, over lags in [0, maxLag]. Independent noise lands around
+	1/sqrt(numSamples * 2 * fc / sampleRate) (the filtered noise has fewer independent samples);
+	anything well above that means two instances (or one instance and its own loop) are audibly
+	repeating each other. The loop itself reads back at r = 1.0 after getLength() samples.
+	echoplex_selftest's noise-loop case (a CTest test) holds two readers under 3x chance level.
+
+	\param offsetA start of the first reader
+	\param offsetB start of the second reader
+	\param numSamples how many samples to compare
+	\param maxLag largest lag to search
+	\return max |r|
+	*/
+	double measureMaxCorrelation(uint32_t offsetA, uint32_t offsetB, uint32_t numSamples, uint32_t maxLag) const
+	{
+		double maxCorrelation = 0.0;
+		for (uint32_t lag = 0; lag <= maxLag; lag++)
+		{
+			double sumAB = 0.0, sumAA = 0.0, sumBB = 0.0;
+			for (uint32_t i = 0; i < numSamples; i++)
+			{
+				double a = read(offsetA + i);
+				double b = read(offsetB + i + lag);
+				sumAB += a * b;
+				sumAA += a * a;
+				sumBB += b * b;
+			}
+			if (sumAA > 0.0 && sumBB > 0.0)
+				maxCorrelation = fmax(maxCorrelation, fabs(sumAB) / sqrt(sumAA * sumBB));
+		}
+		return maxCorrelation;
+	}
+
+private:
+	static std::mutex& getCacheMutex()
+	{
+		static std::mutex cacheMutex;
+		return cacheMutex;
+	}
+
+	static std::vector<std::weak_ptr<const NoiseLoopTable>>& getCache()
+	{
+		static std::vector<std::weak_ptr<const NoiseLoopTable>> cache;
+		return cache;
+	}
+
+	double sampleRate = 0.0;
+	double lpf_fc_Hz = 0.0;
+	NoiseColour colour = NoiseColour::gaussian;
+	double length_Sec = 0.0;
+	uint32_t length = 0;
+	uint32_t wrapMask = 0;
+	float* table = nullptr; ///< ownedTable or caller storage
+	std::unique_ptr<float[]> ownedTable = nullptr;
+};
+
+#endif
@@ -0,0 +1,78 @@
+// -----------------------------------------------------------------------------
+//    Echoplex preset bank:  PresetBank.cpp
+//
+/**
+    \file   PresetBank.cpp
+    \brief  the OS side of PresetBank: mapping and unmapping the bank file; kept out of
+    		PresetBank.h so <windows.h> doesn't reach every file that includes PluginCore.h
+*/
+// -----------------------------------------------------------------------------
+#include "PresetBank.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool PresetBank::mapFile(const char* path)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	fileHandle = file;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		unmapFile();
+		return false;
+	}
+	mappedSize = (size_t)size.QuadPart;
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle)
+		base = (const uint8_t*)MapViewOfFile((HANDLE)mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	fileDescriptor = ::open(path, O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0)
+	{
+		unmapFile();
+		return false;
+	}
+	mappedSize = (size_t)info.st_size;
+	void* memory = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	base = memory == MAP_FAILED ? nullptr : (const uint8_t*)memory;
+#endif
+	if (!base)
+	{
+		unmapFile();
+		return false;
+	}
+	return true;
+}
+
+void PresetBank::unmapFile()
+{
+#if defined(_WIN32)
+	if (base) UnmapViewOfFile(base);
+	if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (base) munmap((void*)base, mappedSize);
+	if (fileDescriptor >= 0) ::close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	base = nullptr;
+	mappedSize = 0;
+}
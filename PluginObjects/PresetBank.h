@@ -0,0 +1,257 @@
+#pragma once
+
+#ifndef __PresetBank__
+#define __PresetBank__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/** 64 bit FNV-1a; the bank index key */
+inline uint64_t presetNameHash(const char* name)
+{
+	uint64_t hash = 14695981039346656037ull;
+	while (*name)
+	{
+		hash ^= (uint8_t)*name++;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+\class PresetBank
+\ingroup FX-Objects
+\brief
+Read-only, memory-mapped binary preset bank. Opening a bank maps the file and checks the
+header and the section bounds - a fixed cost, whatever the size of the library: nothing is
+parsed, walked or allocated per preset. Lookups are a binary search of the hash-sorted index,
+and only the entries a lookup actually reads are bounds-checked (a corrupt entry is then
+simply not found); the values are read straight out of the mapping when a preset is applied.
+
+File layout (little endian, every section 8 byte aligned):
+
+	BankHeader       magic 'EPBK', version, numControls, numPresets, section offsets
+	int32_t          controlIDs[numControls]          column -> controlID
+	BankIndexEntry   index[numPresets]                sorted by nameHash
+	double           values[numPresets][numControls]  actual (not normalized) values
+	char             names[]                          null terminated, referenced by the index
+
+Columns are matched to parameters by controlID, so a bank written before a control existed
+still loads (the new control keeps its current value) and unknown columns are skipped.
+
+Use writeBank() to produce a bank (tools, or "save bank" on the main thread).
+
+\version Revision : 1.1
+\date Date : 2019 / 01 / 31
+*/
+class PresetBank
+{
+public:
+	PresetBank(void) {}	/* C-TOR */
+	~PresetBank(void) { close(); }	/* D-TOR */
+
+	PresetBank(const PresetBank&) = delete;
+	PresetBank& operator=(const PresetBank&) = delete;
+
+	static const uint32_t kMagic = 0x4B425045; ///< "EPBK"
+	static const uint32_t kVersion = 1;
+
+	struct BankHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numControls;
+		uint32_t numPresets;
+		uint64_t controlIDsOffset;
+		uint64_t indexOffset;
+		uint64_t valuesOffset;
+		uint64_t namesOffset;
+		uint64_t fileSize;
+	};
+
+	struct BankIndexEntry
+	{
+		uint64_t nameHash;
+		uint32_t presetNumber;	///< row in values[]
+		uint32_t nameOffset;	///< from namesOffset
+	};
+
+	/** map a bank; false (and the bank stays closed) if the file is missing or its header or section bounds are malformed */
+	bool open(const char* path)
+	{
+		close();
+		if (!mapFile(path))
+			return false;
+		if (!validateHeader())
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		unmapFile();
+		header = nullptr;
+	}
+
+	bool isOpen() const { return header != nullptr; }
+	uint32_t getPresetCount() const { return header ? header->numPresets : 0; }
+	uint32_t getControlCount() const { return header ? header->numControls : 0; }
+	int32_t getControlID(uint32_t column) const { return controlIDs()[column]; }
+
+	/** preset number for a name, or -1; no allocation */
+	int32_t find(const char* name) const
+	{
+		if (!header)
+			return -1;
+		uint64_t hash = presetNameHash(name);
+		const BankIndexEntry* first = index();
+		const BankIndexEntry* last = first + header->numPresets;
+		const BankIndexEntry* entry = std::lower_bound(first, last, hash,
+			[](const BankIndexEntry& e, uint64_t h) { return e.nameHash < h; });
+
+		// --- walk the (almost always length 1) run of equal hashes
+		for (; entry != last && entry->nameHash == hash; entry++)
+			if (isEntryValid(*entry) && strcmp(names() + entry->nameOffset, name) == 0)
+				return (int32_t)entry->presetNumber;
+		return -1;
+	}
+
+	/** numControls actual values, straight from the mapping */
+	const double* getPresetValues(uint32_t presetNumber) const
+	{
+		return values() + (size_t)presetNumber * header->numControls;
+	}
+
+	/** name of the i-th preset in hash order (for browsing), or nullptr if that index entry is corrupt */
+	const char* getPresetName(uint32_t i, uint32_t& presetNumber) const
+	{
+		if (!header || i >= header->numPresets || !isEntryValid(index()[i]))
+			return nullptr;
+		presetNumber = index()[i].presetNumber;
+		return names() + index()[i].nameOffset;
+	}
+
+	/**
+	write a bank; presetValues holds presetNames.size() rows of controlIDs.size() values.
+	Allocates - main thread or offline tools only.
+	*/
+	static bool writeBank(const char* path, const std::vector<int32_t>& bankControlIDs,
+		const std::vector<std::string>& presetNames, const std::vector<double>& presetValues)
+	{
+		uint32_t numControls = (uint32_t)bankControlIDs.size();
+		uint32_t numPresets = (uint32_t)presetNames.size();
+		if (presetValues.size() != (size_t)numControls * numPresets)
+			return false;
+
+		std::vector<BankIndexEntry> entries(numPresets);
+		std::string namePool;
+		for (uint32_t i = 0; i < numPresets; i++)
+		{
+			entries[i].nameHash = presetNameHash(presetNames[i].c_str());
+			entries[i].presetNumber = i;
+			entries[i].nameOffset = (uint32_t)namePool.size();
+			namePool += presetNames[i];
+			namePool.push_back('\0');
+		}
+		std::sort(entries.begin(), entries.end(),
+			[](const BankIndexEntry& a, const BankIndexEntry& b) { return a.nameHash < b.nameHash; });
+
+		BankHeader bankHeader = {};
+		bankHeader.magic = kMagic;
+		bankHeader.version = kVersion;
+		bankHeader.numControls = numControls;
+		bankHeader.numPresets = numPresets;
+		bankHeader.controlIDsOffset = align8(sizeof(BankHeader));
+		bankHeader.indexOffset = align8(bankHeader.controlIDsOffset + numControls * sizeof(int32_t));
+		bankHeader.valuesOffset = align8(bankHeader.indexOffset + numPresets * sizeof(BankIndexEntry));
+		bankHeader.namesOffset = align8(bankHeader.valuesOffset + presetValues.size() * sizeof(double));
+		bankHeader.fileSize = bankHeader.namesOffset + namePool.size();
+
+		std::vector<uint8_t> image((size_t)bankHeader.fileSize, 0);
+		memcpy(&image[0], &bankHeader, sizeof(BankHeader));
+		if (numControls)
+			memcpy(&image[(size_t)bankHeader.controlIDsOffset], &bankControlIDs[0], numControls * sizeof(int32_t));
+		if (numPresets)
+		{
+			memcpy(&image[(size_t)bankHeader.indexOffset], &entries[0], numPresets * sizeof(BankIndexEntry));
+			memcpy(&image[(size_t)bankHeader.namesOffset], namePool.data(), namePool.size());
+		}
+		if (!presetValues.empty())
+			memcpy(&image[(size_t)bankHeader.valuesOffset], &presetValues[0], presetValues.size() * sizeof(double));
+
+		FILE* file = fopen(path, "wb");
+		if (!file)
+			return false;
+		bool ok = fwrite(&image[0], 1, image.size(), file) == image.size();
+		return fclose(file) == 0 && ok;
+	}
+
+private:
+	static uint64_t align8(uint64_t value) { return (value + 7) & ~7ull; }
+
+	const int32_t* controlIDs() const { return (const int32_t*)(base + header->controlIDsOffset); }
+	const BankIndexEntry* index() const { return (const BankIndexEntry*)(base + header->indexOffset); }
+	const double* values() const { return (const double*)(base + header->valuesOffset); }
+	const char* names() const { return (const char*)(base + header->namesOffset); }
+
+	/**
+	header and section bounds only; together with isEntryValid() on each entry read, find() and
+	getPresetName() can't leave the mapping
+	*/
+	bool validateHeader()
+	{
+		if (mappedSize < sizeof(BankHeader))
+			return false;
+		header = (const BankHeader*)base;
+		if (header->magic != kMagic || header->version != kVersion || header->fileSize != mappedSize)
+			return false;
+
+		// --- counts and offsets first, so the section size sums below can't overflow
+		if (header->controlIDsOffset > mappedSize || header->indexOffset > mappedSize ||
+			header->valuesOffset > mappedSize || header->namesOffset > mappedSize)
+			return false;
+		if (header->numControls > mappedSize / sizeof(int32_t) || header->numPresets > mappedSize / sizeof(BankIndexEntry) ||
+			(header->numControls > 0 && header->numPresets > mappedSize / sizeof(double) / header->numControls))
+			return false;
+		if (header->controlIDsOffset < sizeof(BankHeader) || (header->controlIDsOffset & 3) != 0 ||
+			(header->indexOffset & 7) != 0 || (header->valuesOffset & 7) != 0)
+			return false;
+		if (header->controlIDsOffset + (uint64_t)header->numControls * sizeof(int32_t) > header->indexOffset ||
+			header->indexOffset + (uint64_t)header->numPresets * sizeof(BankIndexEntry) > header->valuesOffset ||
+			header->valuesOffset + (uint64_t)header->numPresets * header->numControls * sizeof(double) > header->namesOffset)
+			return false;
+
+		// --- last name must be terminated so strcmp can't run off the end
+		if (header->numPresets > 0 && (header->namesOffset == mappedSize || base[mappedSize - 1] != '\0'))
+			return false;
+		return true;
+	}
+
+	/** the entry names a real row and starts inside the names section (which ends in a null, so the whole name is inside it) */
+	bool isEntryValid(const BankIndexEntry& entry) const
+	{
+		return entry.presetNumber < header->numPresets && entry.nameOffset < mappedSize - header->namesOffset;
+	}
+
+	/** map the whole file read-only (PresetBank.cpp, with the platform headers) */
+	bool mapFile(const char* path);
+	void unmapFile();
+
+	const uint8_t* base = nullptr;
+	size_t mappedSize = 0;
+	const BankHeader* header = nullptr;
+
+	// --- the mapping's OS handles: file and mapping HANDLEs on Windows, a file descriptor elsewhere
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+	int fileDescriptor = -1;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#pragma once
+
+#ifndef __ScaledBitmapCache__
+#define __ScaledBitmapCache__
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Scale GUI options (tiny, small, medium, normal, large, giant); must match PluginGUI::scaleGUISize() */
+const uint32_t kNumGUIScales = 6;
+const double kGUIScaleFactors[kNumGUIScales] = { 0.65, 0.75, 0.85, 1.0, 1.15, 1.25 };
+
+/** 4 bytes per pixel, premultiplied, in whatever channel order the platform bitmap uses */
+struct PixelImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels; ///< width * height * 4, rows packed
+};
+
+/**
+\brief resample a (premultiplied) 4 channel image to round(size * scale)
+
+Area-averaging when shrinking, bilinear when growing; separable, 16.16 fixed point weights.
+For filmstrips (knob bitmaps) pass the height of one frame: vertical taps are clamped to the
+frame each output row falls in, so neighbouring frames never bleed into each other even when
+scaled frame edges land between pixels.
+*/
+inline void resamplePixelImage(const PixelImage& source, double scale, uint32_t frameHeight, PixelImage& destination)
+{
+	struct Tap { uint32_t index; uint32_t weight; };
+	struct Contributions { std::vector<Tap> taps; std::vector<uint32_t> first; };
+
+	// --- per output index: the source taps in [lo, hi) and their weights, summing to 65536
+	auto build = [scale](uint32_t outputLength, uint32_t inputLength, uint32_t segmentLength, Contributions& c)
+	{
+		c.taps.clear();
+		c.first.assign(outputLength + 1, 0);
+		double support = scale < 1.0 ? 0.5 / scale : 1.0;
+		std::vector<double> weights;
+		for (uint32_t o = 0; o < outputLength; o++)
+		{
+			double center = (o + 0.5) / scale;
+			uint32_t segment = (uint32_t)(center < 0.0 ? 0.0 : center) / segmentLength;
+			int64_t lo = (int64_t)segment * segmentLength;
+			int64_t hi = lo + segmentLength < (int64_t)inputLength ? lo + segmentLength : (int64_t)inputLength;
+			int64_t start = (int64_t)floor(center - support);
+			int64_t end = (int64_t)ceil(center + support);
+			start = start < lo ? lo : start;
+			end = end > hi ? hi : end;
+
+			weights.clear();
+			double total = 0.0;
+			for (int64_t i = start; i < end; i++)
+			{
+				// --- box overlap when shrinking, tent when growing
+				double w = scale < 1.0 ?
+					fmin(i + 1.0, center + support) - fmax((double)i, center - support) :
+					1.0 - fabs(i + 0.5 - center);
+				w = w > 0.0 ? w : 0.0;
+				weights.push_back(w);
+				total += w;
+			}
+			c.first[o] = (uint32_t)c.taps.size();
+			if (total <= 0.0)
+			{
+				// --- degenerate (segment narrower than a tap): nearest in-segment pixel
+				int64_t nearest = (int64_t)center < lo ? lo : ((int64_t)center >= hi ? hi - 1 : (int64_t)center);
+				c.taps.push_back({ (uint32_t)nearest, 65536 });
+				continue;
+			}
+			uint32_t assigned = 0;
+			for (size_t k = 0; k < weights.size(); k++)
+			{
+				uint32_t w = (uint32_t)(weights[k] / total * 65536.0 + 0.5);
+				if (k + 1 == weights.size())
+					w = 65536 - assigned;
+				assigned += w;
+				c.taps.push_back({ (uint32_t)(start + k), w });
+			}
+		}
+		c.first[outputLength] = (uint32_t)c.taps.size();
+	};
+
+	destination.width = (uint32_t)floor(source.width * scale + 0.5);
+	destination.height = (uint32_t)floor(source.height * scale + 0.5);
+	destination.width = destination.width ? destination.width : 1;
+	destination.height = destination.height ? destination.height : 1;
+	destination.pixels.assign((size_t)destination.width * destination.height * 4, 0);
+	if (frameHeight == 0 || frameHeight > source.height)
+		frameHeight = source.height;
+
+	Contributions horizontal, vertical;
+	build(destination.width, source.width, source.width, horizontal);
+	build(destination.height, source.height, frameHeight, vertical);
+
+	// --- horizontal pass into 16 bit intermediate (value * 256), then vertical
+	std::vector<uint16_t> intermediate((size_t)destination.width * source.height * 4);
+	for (uint32_t y = 0; y < source.height; y++)
+	{
+		const uint8_t* row = &source.pixels[(size_t)y * source.width * 4];
+		uint16_t* out = &intermediate[(size_t)y * destination.width * 4];
+		for (uint32_t x = 0; x < destination.width; x++)
+		{
+			uint32_t sum[4] = { 0, 0, 0, 0 };
+			for (uint32_t t = horizontal.first[x]; t < horizontal.first[x + 1]; t++)
+			{
+				const uint8_t* p = row + (size_t)horizontal.taps[t].index * 4;
+				for (int ch = 0; ch < 4; ch++)
+					sum[ch] += p[ch] * horizontal.taps[t].weight;
+			}
+			for (int ch = 0; ch < 4; ch++)
+				out[x * 4 + ch] = (uint16_t)((sum[ch] + 128) >> 8);
+		}
+	}
+	for (uint32_t y = 0; y < destination.height; y++)
+	{
+		uint8_t* out = &destination.pixels[(size_t)y * destination.width * 4];
+		for (uint32_t x = 0; x < destination.width * 4; x++)
+		{
+			uint64_t sum = 0;
+			for (uint32_t t = vertical.first[y]; t < vertical.first[y + 1]; t++)
+				sum += (uint64_t)intermediate[(size_t)vertical.taps[t].index * destination.width * 4 + x] * vertical.taps[t].weight;
+			uint32_t value = (uint32_t)((sum + (1u << 23)) >> 24);
+			out[x] = (uint8_t)(value > 255 ? 255 : value);
+		}
+	}
+}
+
+/** a bitmap as the editor scales it: its uidesc name and, for filmstrips, the height of one frame (0 for none) */
+struct ScaledBitmapKey
+{
+	std::string name;
+	uint32_t frameHeight = 0;
+
+	bool operator<(const ScaledBitmapKey& other) const
+	{
+		return name < other.name || (name == other.name && frameHeight < other.frameHeight);
+	}
+};
+
+/**
+\class ScaledBitmapCache
+\ingroup FX-Objects
+\brief
+Process-wide store of GUI bitmaps pre-rendered at Scale GUI factors, rendered lazily: only a
+scale some editor actually selects is ever rendered, once per process, off the UI thread.
+
+request() takes the full size pixels the first time a bitmap is seen (readSource, on the
+caller's thread - a copy out of the platform bitmap) and hands the resample for one scale to
+post, which runs it elsewhere (the plugin passes UIDescriptionCache::post, the editor cache's
+worker). find() never waits: it returns the rendered image once the job has finished, else
+nullptr, and the editor keeps drawing with VSTGUI's own scaling until then. Every later
+editor, in any instance, gets the same immutable images back.
+
+Keyed by (name, frame height): the same bitmap used whole and as a filmstrip is two entries.
+Thread safe.
+
+\version Revision : 1.1
+\date Date : 2019 / 01 / 31
+*/
+class ScaledBitmapCache
+{
+public:
+	typedef std::shared_ptr<const PixelImage> ImagePtr;
+
+	/** the pre-rendered image for one scale, or nullptr if it isn't rendered (yet) */
+	static ImagePtr find(const ScaledBitmapKey& key, uint32_t scaleIndex)
+	{
+		Storage& storage = getStorage();
+		std::lock_guard<std::mutex> lock(storage.cacheMutex);
+		auto it = storage.cache.find(key);
+		return it != storage.cache.end() && scaleIndex < kNumGUIScales ? it->second.image[scaleIndex] : nullptr;
+	}
+
+	/**
+	make sure one scale of a bitmap is rendered or on its way: bool readSource(PixelImage&) is
+	called here only the first time the key is seen, void post(std::function<void()>) at most
+	once per key and scale. false if the source can't be read (or the scale is 1.0, which is
+	the bitmap itself)
+	*/
+	template <typename ReadSource, typename Post>
+	static bool request(const ScaledBitmapKey& key, uint32_t scaleIndex, ReadSource readSource, Post post)
+	{
+		if (scaleIndex >= kNumGUIScales || kGUIScaleFactors[scaleIndex] == 1.0)
+			return false;
+
+		Storage& storage = getStorage();
+		std::shared_ptr<const PixelImage> source;
+		{
+			std::lock_guard<std::mutex> lock(storage.cacheMutex);
+			Entry& entry = storage.cache[key];
+			if (entry.image[scaleIndex] || entry.requested[scaleIndex])
+				return true;
+			if (!entry.source)
+			{
+				std::shared_ptr<PixelImage> pixels = std::make_shared<PixelImage>();
+				if (!readSource(*pixels) || pixels->width == 0 || pixels->height == 0)
+				{
+					storage.cache.erase(key);
+					return false;
+				}
+				entry.source = pixels;
+			}
+			entry.requested[scaleIndex] = true;
+			source = entry.source;
+		}
+
+		post([key, scaleIndex, source]()
+		{
+			std::shared_ptr<PixelImage> scaled = std::make_shared<PixelImage>();
+			resamplePixelImage(*source, kGUIScaleFactors[scaleIndex], key.frameHeight, *scaled);
+
+			Storage& storage = getStorage();
+			std::lock_guard<std::mutex> lock(storage.cacheMutex);
+			storage.cache[key].image[scaleIndex] = scaled;
+		});
+		return true;
+	}
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<const PixelImage> source;	///< full size, kept while any scale may still be asked for
+		ImagePtr image[kNumGUIScales];				///< parallel to kGUIScaleFactors; the 1.0 entry stays empty
+		bool requested[kNumGUIScales] = {};
+	};
+
+	struct Storage
+	{
+		std::mutex cacheMutex;
+		std::map<ScaledBitmapKey, Entry> cache;
+	};
+
+	/** one store per process, shared by every request() instantiation */
+	static Storage& getStorage()
+	{
+		static Storage storage;
+		return storage;
+	}
+};
+
+#endif
@@ -0,0 +1,174 @@
+#pragma once
+
+#ifndef __StageProfiler__
+#define __StageProfiler__
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// --- off unless the build defines it (CMake: -DECHOPLEX_STAGE_PROFILING=ON; Visual Studio: add it to
+//     the preprocessor definitions); when off the lap macro below is empty and PluginCore carries no profiler
+#ifndef ECHOPLEX_STAGE_PROFILING
+#define ECHOPLEX_STAGE_PROFILING 0
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ECHOPLEX_PROFILE_TSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define ECHOPLEX_PROFILE_TSC 1
+#else
+#define ECHOPLEX_PROFILE_TSC 0
+#endif
+
+/** where the audio thread's time goes, per buffer */
+enum profileStage : uint32_t
+{
+	kStageParameters,	///< dirty-control sync and cooking, smoothing, morph, per-frame setParameters()
+	kStageModulator,	///< EchoplexDelayModulator::renderAudioOutput()
+	kStageTapeDelay,	///< TapeEchoDelay::processAudioFrame()
+	kStageIO,			///< the kernel's buffer <-> frame conversion, MIDI, output copy and telemetry
+	kNumProfileStages
+};
+
+/**
+\class StageProfiler
+\ingroup FX-Objects
+\brief
+Per-stage cycle counters for the audio thread. beginBuffer() takes a timestamp; each lap(stage)
+charges the time since the previous timestamp to that stage, so every tick between beginBuffer()
+and endBuffer() lands in exactly one stage and the stages add up to the whole buffer.
+
+The clock is the TSC (__rdtsc, ~20 cycles a read) on x86, steady_clock elsewhere; its rate is
+measured against steady_clock once per process, in the first reset(). endBuffer() turns the
+buffer's ticks into loads - seconds spent over seconds of audio, so 1.0 is the whole real-time
+budget - for the meters, and adds them into running totals for offline reports.
+
+Audio thread only; nothing here locks or allocates.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class StageProfiler
+{
+public:
+	/** short names, as used in the JSON reports */
+	static const char* getStageName(uint32_t stage)
+	{
+		static const char* const names[kNumProfileStages] = { "parameters", "modulator", "tape_delay", "io" };
+		return stage < kNumProfileStages ? names[stage] : "";
+	}
+
+	static const char* getClockName() { return ECHOPLEX_PROFILE_TSC ? "tsc" : "steady_clock"; }
+
+	static inline uint64_t readClock()
+	{
+#if ECHOPLEX_PROFILE_TSC
+		return (uint64_t)__rdtsc();
+#else
+		return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	/** clock ticks per second; the first call spends ~20 mSec measuring the TSC */
+	static double getTicksPerSecond()
+	{
+		static const double ticksPerSecond = measureTicksPerSecond();
+		return ticksPerSecond;
+	}
+
+	/** main thread, from PluginCore::reset() */
+	void reset(double _sampleRate)
+	{
+		sampleRate = _sampleRate;
+		secondsPerTick = 1.0 / getTicksPerSecond();
+		clearTotals();
+	}
+
+	void clearTotals()
+	{
+		for (uint32_t i = 0; i < kNumProfileStages; i++)
+		{
+			bufferTicks[i] = 0;
+			totalTicks[i] = 0;
+			load[i] = 0.f;
+		}
+		totalFrames = 0;
+		bufferCount = 0;
+	}
+
+	inline void beginBuffer() { lastStamp = readClock(); }
+
+	/** charge the time since the last stamp to stage */
+	inline void lap(uint32_t stage)
+	{
+		uint64_t now = readClock();
+		bufferTicks[stage] += now - lastStamp;
+		lastStamp = now;
+	}
+
+	/** close the buffer: update the loads and totals */
+	void endBuffer(uint32_t frames)
+	{
+		double bufferSeconds = sampleRate > 0.0 ? (double)frames / sampleRate : 0.0;
+		for (uint32_t i = 0; i < kNumProfileStages; i++)
+		{
+			load[i] = bufferSeconds > 0.0 ? (float)((double)bufferTicks[i] * secondsPerTick / bufferSeconds) : 0.f;
+			totalTicks[i] += bufferTicks[i];
+			bufferTicks[i] = 0;
+		}
+		totalFrames += frames;
+		bufferCount++;
+	}
+
+	/** stage's share of the real-time budget in the last buffer (1.0 = all of it) */
+	float getLoad(uint32_t stage) const { return load[stage]; }
+	float getTotalLoad() const
+	{
+		float sum = 0.f;
+		for (uint32_t i = 0; i < kNumProfileStages; i++)
+			sum += load[i];
+		return sum;
+	}
+
+	uint64_t getTotalTicks(uint32_t stage) const { return totalTicks[stage]; }
+	uint64_t getTotalFrames() const { return totalFrames; }
+	uint64_t getBufferCount() const { return bufferCount; }
+	double getSampleRate() const { return sampleRate; }
+
+private:
+	static double measureTicksPerSecond()
+	{
+#if ECHOPLEX_PROFILE_TSC
+		auto start = std::chrono::steady_clock::now();
+		uint64_t startTicks = readClock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		uint64_t ticks = readClock() - startTicks;
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return seconds > 0.0 && ticks > 0 ? (double)ticks / seconds : 1.0e9;
+#else
+		return (double)std::chrono::steady_clock::period::den / (double)std::chrono::steady_clock::period::num;
+#endif
+	}
+
+	double sampleRate = 0.0;
+	double secondsPerTick = 0.0;
+	uint64_t lastStamp = 0;
+	uint64_t bufferTicks[kNumProfileStages] = { 0 };
+	uint64_t totalTicks[kNumProfileStages] = { 0 };
+	float load[kNumProfileStages] = { 0.f };
+	uint64_t totalFrames = 0;
+	uint64_t bufferCount = 0;
+};
+
+#if ECHOPLEX_STAGE_PROFILING
+#define STAGE_PROFILE_BEGIN(profiler) (profiler).beginBuffer()
+#define STAGE_PROFILE_LAP(profiler, stage) (profiler).lap(stage)
+#else
+#define STAGE_PROFILE_BEGIN(profiler) ((void)0)
+#define STAGE_PROFILE_LAP(profiler, stage) ((void)0)
+#endif
+
+#endif
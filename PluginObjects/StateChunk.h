@@ -0,0 +1,155 @@
+#pragma once
+
+#ifndef __StateChunk__
+#define __StateChunk__
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/** four character section tag, stored as a little endian uint32 */
+#define STATECHUNK_TAG(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/**
+\class StateChunkWriter
+\ingroup FX-Objects
+\brief
+Appends a versioned binary state chunk to a byte vector.
+
+A chunk is a header (magic, version) followed by tagged sections: { uint32 tag, uint32 size,
+payload }. Readers skip tags they don't know, so sections can be added without breaking older
+builds, and a missing section just leaves that part of the state alone. Values are stored in
+the machine's (little endian, on every target we build for) byte order.
+
+Runs on the main thread; reserve() the vector up front to keep it to one allocation.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class StateChunkWriter
+{
+public:
+	explicit StateChunkWriter(std::vector<uint8_t>& _chunk) : chunk(_chunk) {}	/* C-TOR */
+
+	void writeHeader(uint32_t magic, uint32_t version)
+	{
+		writeValue(magic);
+		writeValue(version);
+	}
+
+	/** start a section; pass the return value to endSection() */
+	size_t beginSection(uint32_t tag)
+	{
+		writeValue(tag);
+		size_t sizeOffset = chunk.size();
+		writeValue((uint32_t)0);
+		return sizeOffset;
+	}
+
+	/** patch the section size in now that the payload is written */
+	void endSection(size_t sizeOffset)
+	{
+		uint32_t size = (uint32_t)(chunk.size() - sizeOffset - sizeof(uint32_t));
+		memcpy(&chunk[sizeOffset], &size, sizeof(uint32_t));
+	}
+
+	template <typename T>
+	void writeValue(T value)
+	{
+		size_t offset = chunk.size();
+		chunk.resize(offset + sizeof(T));
+		memcpy(&chunk[offset], &value, sizeof(T));
+	}
+
+	/** count values, raw; for snapshots of sample memory */
+	template <typename T>
+	void writeArray(const T* values, size_t count)
+	{
+		if (count == 0)
+			return;
+		size_t offset = chunk.size();
+		chunk.resize(offset + count * sizeof(T));
+		memcpy(&chunk[offset], values, count * sizeof(T));
+	}
+
+private:
+	std::vector<uint8_t>& chunk;
+};
+
+/**
+\class StateChunkReader
+\ingroup FX-Objects
+\brief
+Bounds-checked cursor over a chunk written by StateChunkWriter. Every read returns false (and
+leaves the target alone) once the data runs out, so a truncated or corrupt chunk can't read
+past its end.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class StateChunkReader
+{
+public:
+	StateChunkReader(const uint8_t* _data, size_t _size) : data(_data), size(_size) {}	/* C-TOR */
+
+	bool readHeader(uint32_t magic, uint32_t& version)
+	{
+		uint32_t chunkMagic = 0;
+		return readValue(chunkMagic) && chunkMagic == magic && readValue(version);
+	}
+
+	/** next section header; the payload is returned as its own reader, and this one skips past it */
+	bool nextSection(uint32_t& tag, StateChunkReader& section)
+	{
+		uint32_t sectionSize = 0;
+		if (!readValue(tag) || !readValue(sectionSize) || sectionSize > size - position)
+			return false;
+		section = StateChunkReader(data + position, sectionSize);
+		position += sectionSize;
+		return true;
+	}
+
+	template <typename T>
+	bool readValue(T& value)
+	{
+		if (size - position < sizeof(T))
+			return false;
+		memcpy(&value, data + position, sizeof(T));
+		position += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	bool readArray(T* values, size_t count)
+	{
+		if ((size - position) / sizeof(T) < count)
+			return false;
+		if (count > 0)
+			memcpy(values, data + position, count * sizeof(T));
+		position += count * sizeof(T);
+		return true;
+	}
+
+	/** skip count values of type T */
+	template <typename T>
+	bool skip(size_t count)
+	{
+		if ((size - position) / sizeof(T) < count)
+			return false;
+		position += count * sizeof(T);
+		return true;
+	}
+
+	bool atEnd() const { return position >= size; }
+
+	/** the bytes this reader covers, for keeping a section to read later */
+	const uint8_t* getData() const { return data; }
+	size_t getSize() const { return size; }
+
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	size_t position = 0;
+};
+
+#endif
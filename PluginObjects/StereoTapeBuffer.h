@@ -0,0 +1,438 @@
+#pragma once
+
+#ifndef __StereoTapeBuffer__
+#define __StereoTapeBuffer__
+
+#include "fxobjects.h"
+#include "TapeReadHead.h"
+
+/**
+\struct StereoTapeBufferParameters
+\ingroup FX-Objects
+\brief
+Custom parameter structure for the StereoTapeBuffer object.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+struct StereoTapeBufferParameters
+{
+	StereoTapeBufferParameters() {}
+
+	/** all FXObjects parameter objects require overloaded= operator so remember to add new entries if you add new variables. */
+	StereoTapeBufferParameters& operator=(const StereoTapeBufferParameters& params)	// need this override for collections to work
+	{
+		if (this == &params)
+			return *this;
+
+		interpolation = params.interpolation;
+
+		// --- MUST be last
+		return *this;
+	}
+
+	// --- individual parameters
+	TapeInterpolation interpolation = TapeInterpolation::linear;
+};
+
+/**
+\class StereoTapeBuffer
+\ingroup FX-Objects
+\brief
+Interleaved L/R float tape: frame n lives at buffer[2n], buffer[2n + 1].
+
+When both channels read at the same delay (the Echoplex modulator drives leftDelay_mSec
+and rightDelay_mSec with the same value) readFrameAtSamples(delay, ...) does the index and
+weight math once and runs the interpolation as a 2-lane SIMD dot product: each tap pair is
+one 16 byte load of [L(k) R(k) L(k+1) R(k+1)] against [w(k) w(k) w(k+1) w(k+1)].
+readFrameAtSamples(delayL, delayR, ...) is the fallback for unlinked delays.
+
+Against two CircularBuffer<double> lines this is half the memory per second of delay
+(8 bytes per frame instead of 16) and the two reads share their cache lines.
+
+Uses the TapeReadHead weight functions and the same mirrored guard region, so windows never
+wrap; minimum delays are the same as TapeReadHead's.
+With thiran each read advances the allpass state, so read once per frame.
+
+Audio I/O:
+- Processes stereo frames.
+
+Control I/F:
+- Use StereoTapeBufferParameters structure to get/set object params.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class StereoTapeBuffer
+{
+public:
+	StereoTapeBuffer(void) { cookInterpolation(); }	/* C-TOR */
+	~StereoTapeBuffer(void) {}	/* D-TOR */
+
+public:
+	/**
+	size the ring, rounded up to a power of two frames; allocates only if it has to grow past the
+	current capacity, otherwise clears what was written and reuses the memory
+	*/
+	void createDelayBuffer(double _sampleRate, double _bufferLength_mSec)
+	{
+		uint32_t requiredLength = getRequiredLength(_sampleRate, _bufferLength_mSec);
+		if (buffer && requiredLength <= bufferCapacity)
+		{
+			flushBuffer(); // --- in the old geometry
+			sampleRate = _sampleRate;
+			samplesPerMSec = sampleRate / 1000.0;
+			bufferLength_mSec = _bufferLength_mSec;
+			bufferLength = requiredLength;
+			wrapMask = bufferLength - 1;
+			return;
+		}
+
+		sampleRate = _sampleRate;
+		samplesPerMSec = sampleRate / 1000.0;
+		bufferLength_mSec = _bufferLength_mSec;
+
+		bufferLength = requiredLength;
+		wrapMask = bufferLength - 1;
+
+		// --- arena region if it's big enough, else our own buffer
+		if (bufferLength <= arenaLength)
+		{
+			ownedBuffer = nullptr;
+			buffer = arenaBuffer;
+			bufferCapacity = arenaLength;
+		}
+		else
+		{
+			ownedBuffer.reset(new float[2 * (bufferLength + kMaxInterpolatorTaps)]);
+			buffer = ownedBuffer.get();
+			bufferCapacity = bufferLength;
+		}
+		samplesWritten = UINT64_MAX; // --- unknown contents: clear all of it
+		flushBuffer();
+	}
+
+	/** zero the written region; cheap after a short run */
+	void flushBuffer()
+	{
+		// --- only what was written since the last flush, plus the guard mirror
+		clearWrittenRegion(buffer, bufferLength, writeIndex, samplesWritten, 2);
+		memset(buffer + 2 * bufferLength, 0, 2 * kMaxInterpolatorTaps * sizeof(float));
+		samplesWritten = 0;
+		writeIndex = 0;
+		thiranState[0] = 0.0;
+		thiranState[1] = 0.0;
+	}
+
+	/**
+	append the tape contents, oldest frame first; only the part written since the last flush.
+	A mono source records the same samples on both tracks, so when they match over the whole
+	written part one track is stored (half the bytes); otherwise both go in interleaved. The
+	samples are raw floats either way: general purpose coders (gzip, xz) save 8-17% on a track
+	of sine or noise, not enough to be worth a codec here.
+	*/
+	void saveSnapshot(StateChunkWriter& writer)
+	{
+		uint32_t count = samplesWritten < bufferLength ? (uint32_t)samplesWritten : bufferLength;
+		uint32_t start = (writeIndex - count) & wrapMask;
+		uint32_t firstSpan = count < bufferLength - start ? count : bufferLength - start;
+		bool sharedTrack = tracksMatch(start, firstSpan) && tracksMatch(0, count - firstSpan);
+		writer.writeValue(count);
+		writer.writeValue((uint32_t)(sharedTrack ? kSnapshotSharedTrack : kSnapshotInterleaved));
+		if (!sharedTrack)
+		{
+			writer.writeArray(buffer + 2 * start, 2 * firstSpan);
+			writer.writeArray(buffer, 2 * (count - firstSpan));
+			return;
+		}
+		for (uint32_t n = 0; n < firstSpan; n++)
+			writer.writeValue(buffer[2 * (start + n)]);
+		for (uint32_t n = 0; n < count - firstSpan; n++)
+			writer.writeValue(buffer[2 * n]);
+	}
+
+	/** flush, then copy a saveSnapshot() straight into the ring; main thread, not while processing */
+	bool loadSnapshot(StateChunkReader& reader)
+	{
+		uint32_t count = 0;
+		uint32_t layout = 0;
+		if (!buffer || !reader.readValue(count) || !reader.readValue(layout) || layout > kSnapshotSharedTrack)
+			return false;
+		flushBuffer();
+		uint32_t skip = count > bufferLength ? count - bufferLength : 0;
+		uint32_t kept = count - skip;
+		if (layout == kSnapshotInterleaved)
+		{
+			if (!reader.skip<float>(2 * (size_t)skip) || !reader.readArray(buffer, 2 * (size_t)kept))
+				return false;
+		}
+		else
+		{
+			if (!reader.skip<float>(skip))
+				return false;
+			for (uint32_t n = 0; n < kept; n++)
+			{
+				if (!reader.readValue(buffer[2 * n]))
+					return false;
+				buffer[2 * n + 1] = buffer[2 * n];
+			}
+		}
+
+		writeIndex = kept & wrapMask;
+		samplesWritten = kept;
+		memcpy(buffer + 2 * bufferLength, buffer, 2 * kMaxInterpolatorTaps * sizeof(float)); // --- guard mirror
+		return true;
+	}
+
+	inline void writeFrame(double xnL, double xnR)
+	{
+		uint32_t i = 2 * writeIndex;
+		buffer[i] = (float)xnL;
+		buffer[i + 1] = (float)xnR;
+		if (writeIndex < kMaxInterpolatorTaps)
+		{
+			// --- guard mirror
+			buffer[2 * bufferLength + i] = (float)xnL;
+			buffer[2 * bufferLength + i + 1] = (float)xnR;
+		}
+		writeIndex = (writeIndex + 1) & wrapMask;
+		samplesWritten++;
+	}
+
+	/** linked read: both channels at the same delay */
+	inline void readFrameAtSamples(double delay_Samples, double& ynL, double& ynR)
+	{
+		(this->*linkedKernel)(delay_Samples, ynL, ynR);
+	}
+
+	/** unlinked read: two address/weight calculations */
+	inline void readFrameAtSamples(double delayL_Samples, double delayR_Samples, double& ynL, double& ynR)
+	{
+		if (delayL_Samples == delayR_Samples)
+		{
+			readFrameAtSamples(delayL_Samples, ynL, ynR);
+			return;
+		}
+		double unused = 0.0;
+		(this->*channelKernel)(delayL_Samples, 0, ynL, unused);
+		(this->*channelKernel)(delayR_Samples, 1, unused, ynR);
+	}
+
+	inline void readFrameAtTime_mSec(double delay_mSec, double& ynL, double& ynR)
+	{
+		readFrameAtSamples(delay_mSec * samplesPerMSec, ynL, ynR);
+	}
+
+	/** ring length in frames (power of two, excluding the guard) for a rate and capacity */
+	static uint32_t getRequiredLength(double _sampleRate, double _bufferLength_mSec)
+	{
+		uint32_t minLength = (uint32_t)(_bufferLength_mSec * _sampleRate / 1000.0) + kMaxInterpolatorTaps;
+		uint32_t length = 1;
+		while (length < minLength)
+			length <<= 1;
+		return length;
+	}
+
+	/** arena bytes attachArena() will take */
+	static size_t getArenaBytes(double maxSampleRate, double _bufferLength_mSec)
+	{
+		return DSPArena::regionBytes<float>(2 * (getRequiredLength(maxSampleRate, _bufferLength_mSec) + kMaxInterpolatorTaps));
+	}
+
+	/** take the ring from the arena, sized for maxSampleRate; createDelayBuffer() then never allocates */
+	void attachArena(DSPArena& arena, double maxSampleRate, double _bufferLength_mSec)
+	{
+		uint32_t length = getRequiredLength(maxSampleRate, _bufferLength_mSec);
+		arenaBuffer = arena.allocate<float>(2 * (length + kMaxInterpolatorTaps), "StereoTapeBuffer tape");
+		arenaLength = arenaBuffer ? length : 0;
+	}
+
+	/** bytes held by the tape */
+	size_t getDelayMemoryBytes() { return 2 * (bufferLength + kMaxInterpolatorTaps) * sizeof(float); }
+
+	/** get parameters: note use of custom structure for passing param data */
+	/**
+	\return StereoTapeBufferParameters custom data structure
+	*/
+	StereoTapeBufferParameters getParameters()
+	{
+		return parameters;
+	}
+
+	/** set parameters: note use of custom structure for passing param data */
+	/**
+	\param StereoTapeBufferParameters custom data structure
+	*/
+	void setParameters(const StereoTapeBufferParameters& _params)
+	{
+		bool cook = _params.interpolation != parameters.interpolation;
+		parameters = _params;
+		if (cook)
+			cookInterpolation();
+	}
+
+protected:
+	enum { kSnapshotInterleaved, kSnapshotSharedTrack }; ///< saveSnapshot() layouts
+
+	/** true when L and R hold the same samples over count frames from frame start */
+	bool tracksMatch(uint32_t start, uint32_t count)
+	{
+		const float* frame = buffer + 2 * start;
+		for (uint32_t n = 0; n < count; n++)
+		{
+			if (memcmp(&frame[2 * n], &frame[2 * n + 1], sizeof(float)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	void cookInterpolation()
+	{
+		switch (parameters.interpolation)
+		{
+			case TapeInterpolation::hermite:
+				linkedKernel = &StereoTapeBuffer::readLinked<4, 1, hermiteWeights>;
+				channelKernel = &StereoTapeBuffer::readChannel<4, 1, hermiteWeights>;
+				break;
+			case TapeInterpolation::lagrange4:
+				linkedKernel = &StereoTapeBuffer::readLinked<4, 1, lagrange4Weights>;
+				channelKernel = &StereoTapeBuffer::readChannel<4, 1, lagrange4Weights>;
+				break;
+			case TapeInterpolation::lagrange6:
+				linkedKernel = &StereoTapeBuffer::readLinked<8, 2, lagrange6Weights>;
+				channelKernel = &StereoTapeBuffer::readChannel<8, 2, lagrange6Weights>;
+				break;
+			case TapeInterpolation::windowedSinc:
+				WindowedSincTable::get(); // --- build it now, not on the audio thread
+				linkedKernel = &StereoTapeBuffer::readLinked<WindowedSincTable::kTaps, WindowedSincTable::kPre, windowedSincWeights>;
+				channelKernel = &StereoTapeBuffer::readChannel<WindowedSincTable::kTaps, WindowedSincTable::kPre, windowedSincWeights>;
+				break;
+			case TapeInterpolation::thiran:
+				linkedKernel = &StereoTapeBuffer::readThiranLinked;
+				channelKernel = &StereoTapeBuffer::readThiranChannel;
+				break;
+			default:
+				linkedKernel = &StereoTapeBuffer::readLinked<2, 0, linearWeights>;
+				channelKernel = &StereoTapeBuffer::readChannel<2, 0, linearWeights>;
+				break;
+		}
+		thiranState[0] = 0.0;
+		thiranState[1] = 0.0;
+	}
+
+	/** delay -> first frame of the tap window (as a float index) and t */
+	template <uint32_t TAPS, uint32_t PRE>
+	inline uint32_t locateWindow(double delay_Samples, float& t)
+	{
+		const double minDelay = (double)(TAPS - PRE);
+		const double maxDelay = (double)(bufferLength - TAPS);
+		delay_Samples = delay_Samples < minDelay ? minDelay : (delay_Samples > maxDelay ? maxDelay : delay_Samples);
+		uint32_t delayInt = (uint32_t)delay_Samples;
+		t = (float)(1.0 - (delay_Samples - delayInt));
+		return 2 * ((writeIndex - delayInt - 1 - PRE) & wrapMask);
+	}
+
+	template <uint32_t TAPS, uint32_t PRE, void (*WEIGHTS)(float, float*)>
+	void readLinked(double delay_Samples, double& ynL, double& ynR)
+	{
+		float t = 0.f;
+		const float* window = &buffer[locateWindow<TAPS, PRE>(delay_Samples, t)];
+		float w[TAPS];
+		WEIGHTS(t, w);
+
+#ifdef TAPEREAD_USE_SSE2
+		__m128 acc = _mm_setzero_ps();
+		for (uint32_t k = 0; k < TAPS; k += 2)
+		{
+			__m128 weights = _mm_setr_ps(w[k], w[k], w[k + 1], w[k + 1]);
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(window + 2 * k), weights));
+		}
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc)); // --- lanes 0, 1 = L, R
+		float frame[4];
+		_mm_storeu_ps(frame, acc);
+		ynL = frame[0];
+		ynR = frame[1];
+#else
+		float sumL = 0.f, sumR = 0.f;
+		for (uint32_t k = 0; k < TAPS; k++)
+		{
+			sumL += window[2 * k] * w[k];
+			sumR += window[2 * k + 1] * w[k];
+		}
+		ynL = sumL;
+		ynR = sumR;
+#endif
+	}
+
+	template <uint32_t TAPS, uint32_t PRE, void (*WEIGHTS)(float, float*)>
+	void readChannel(double delay_Samples, uint32_t channel, double& ynL, double& ynR)
+	{
+		float t = 0.f;
+		const float* window = &buffer[locateWindow<TAPS, PRE>(delay_Samples, t) + channel];
+		float w[TAPS];
+		WEIGHTS(t, w);
+		float sum = 0.f;
+		for (uint32_t k = 0; k < TAPS; k++)
+			sum += window[2 * k] * w[k];
+		(channel == 0 ? ynL : ynR) = sum;
+	}
+
+	/** Thiran coefficients and the two frame indices, shared by both channels when linked */
+	inline double thiranSetup(double delay_Samples, uint32_t& i0, uint32_t& i1)
+	{
+		const double maxDelay = (double)(bufferLength - 4);
+		delay_Samples = delay_Samples < 2.0 ? 2.0 : (delay_Samples > maxDelay ? maxDelay : delay_Samples);
+		uint32_t N = (uint32_t)delay_Samples;
+		double delta = delay_Samples - N;
+		if (delta < 0.5)
+		{
+			delta += 1.0;
+			N -= 1;
+		}
+		i0 = 2 * ((writeIndex - N) & wrapMask);
+		i1 = 2 * ((writeIndex - N - 1) & wrapMask);
+		return (1.0 - delta) / (1.0 + delta);
+	}
+
+	void readThiranLinked(double delay_Samples, double& ynL, double& ynR)
+	{
+		uint32_t i0 = 0, i1 = 0;
+		double a = thiranSetup(delay_Samples, i0, i1);
+		thiranState[0] = a * buffer[i0] + buffer[i1] - a * thiranState[0];
+		thiranState[1] = a * buffer[i0 + 1] + buffer[i1 + 1] - a * thiranState[1];
+		ynL = thiranState[0];
+		ynR = thiranState[1];
+	}
+
+	void readThiranChannel(double delay_Samples, uint32_t channel, double& ynL, double& ynR)
+	{
+		uint32_t i0 = 0, i1 = 0;
+		double a = thiranSetup(delay_Samples, i0, i1);
+		thiranState[channel] = a * buffer[i0 + channel] + buffer[i1 + channel] - a * thiranState[channel];
+		(channel == 0 ? ynL : ynR) = thiranState[channel];
+	}
+
+private:
+	StereoTapeBufferParameters parameters; ///< object parameters
+
+	float* buffer = nullptr; ///< arenaBuffer or ownedBuffer
+	std::unique_ptr<float[]> ownedBuffer = nullptr;
+	float* arenaBuffer = nullptr;
+	uint32_t arenaLength = 0;
+	uint32_t bufferCapacity = 0; ///< allocated length in frames; bufferLength <= bufferCapacity
+	uint64_t samplesWritten = 0; ///< since the last flush; bounds the region flushBuffer() touches
+	uint32_t bufferLength = 0; ///< in frames
+	uint32_t wrapMask = 0;
+	uint32_t writeIndex = 0;
+	double thiranState[2] = { 0.0, 0.0 };
+
+	void (StereoTapeBuffer::*linkedKernel)(double, double&, double&) = nullptr;
+	void (StereoTapeBuffer::*channelKernel)(double, uint32_t, double&, double&) = nullptr;
+
+	// --- local variables used by this object
+	double sampleRate = 0.0;	///< sample rate
+	double samplesPerMSec = 0.0;
+	double bufferLength_mSec = 1000.0;
+};
+
+#endif
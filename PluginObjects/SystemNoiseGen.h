@@ -4,8 +4,20 @@
 #define __SystemNoiseGen__
 
 #include "fxobjects.h"
-#include "LFOEx.h"
 #include "noisegen.h"
+#include "NoiseLoopTable.h"
+
+/** mains hum fundamental */
+enum class MainsFrequency { fiftyHz, sixtyHz };
+
+/** playback positions of the hum cycle and the noise loop; what reset() randomizes */
+struct SystemNoiseGenState
+{
+	double humPhase = 0.0;
+	uint32_t noiseTableIndex = 0;
+	bool reverseNoiseTable = false;
+};
+
 /**
 \struct SystemNoiseGenParameters
 \ingroup FX-Objects
@@ -35,6 +47,11 @@ struct SystemNoiseGenParameters
 		sixtyHzNoiseAmplitude = params.sixtyHzNoiseAmplitude;
 		tapeNoiseFc_Hz = params.tapeNoiseFc_Hz;
 		tapeNoiseAmplitude = params.tapeNoiseAmplitude;
+		noiseColour = params.noiseColour;
+		noiseTableMode = params.noiseTableMode;
+		noiseTableLength_Sec = params.noiseTableLength_Sec;
+		mainsFrequency = params.mainsFrequency;
+		humHarmonics = params.humHarmonics;
 
 
 		// --- MUST be last
@@ -46,6 +63,11 @@ struct SystemNoiseGenParameters
 	double sixtyHzNoiseAmplitude = 1.0;
 	double tapeNoiseFc_Hz = 10000.0;
 	double tapeNoiseAmplitude = 1.0;	///< init
+	NoiseColour noiseColour = NoiseColour::gaussian; ///< colour of the filtered drift noise
+	NoiseTableMode noiseTableMode = NoiseTableMode::off; ///< read the drift noise from a pre-rendered loop
+	double noiseTableLength_Sec = 6.0; ///< minimum loop length; rounded up to a power of two samples
+	MainsFrequency mainsFrequency = MainsFrequency::sixtyHz; ///< hum fundamental
+	double humHarmonics = 0.0; ///< [0, 1] blend of 2nd/3rd/5th harmonics into the hum before saturation
 };
 
 
@@ -79,14 +101,42 @@ public:
 	{
 		// --- store the sample rate
 		sampleRate = (_sampleRate);
-		LFO_ExParameters lparams = lfoEx.getParameters();
-		lparams.waveform = generatorWaveform::kSin;
-		lparams.frequency_Hz = 60.0;
-		lfoEx.setParameters(lparams);
-		lfoEx.reset(sampleRate);
 
+		// --- hum: one saturated cycle in a table, played back with a phase accumulator
+		humPhase = 0.0;
+		humPhaseInc = getMainsFrequency_Hz() / sampleRate;
+		renderHumTable();
+
+		// --- we only consume one filtered output; don't render the rest
+		NoiseGeneratorParameters noiseParams = noiseGen.getParameters();
+		noiseParams.requiredOutputs = filteredNoiseOutputFor(Sysparameters.noiseColour);
+		noiseGen.setParameters(noiseParams);
 		noiseGen.reset(sampleRate);
 
+		// --- noise table: built (or looked up) here, never on the audio thread; a transport
+		//     reset with unchanged settings keeps the one we have
+		bool keepTable = noiseTable && noiseTableMode == Sysparameters.noiseTableMode &&
+			noiseTable->matches(sampleRate, Sysparameters.tapeNoiseFc_Hz, Sysparameters.noiseColour, Sysparameters.noiseTableLength_Sec);
+		if (!keepTable)
+		{
+			noiseTable = nullptr;
+			if (Sysparameters.noiseTableMode == NoiseTableMode::shared)
+				noiseTable = NoiseLoopTable::getShared(sampleRate, Sysparameters.tapeNoiseFc_Hz, Sysparameters.noiseColour, Sysparameters.noiseTableLength_Sec);
+			else if (Sysparameters.noiseTableMode == NoiseTableMode::perInstance)
+				noiseTable = std::make_shared<const NoiseLoopTable>(sampleRate, Sysparameters.tapeNoiseFc_Hz, Sysparameters.noiseColour, Sysparameters.noiseTableLength_Sec, (uint32_t)rand() * 2654435761u + 1u,
+					arenaNoiseTable, arenaNoiseTableLength);
+		}
+		noiseTableMode = Sysparameters.noiseTableMode;
+		useNoiseTable = false;
+
+		if (noiseTable)
+		{
+			// --- own offset and direction so instances sharing the table stay decorrelated
+			noiseTableIndex = (uint32_t)rand() * 2654435761u;
+			noiseTableStride = (rand() & 1) ? 1 : noiseTable->getWrapMask(); // --- wrapMask == -1 modulo length
+			useNoiseTable = true;
+		}
+
 		// --- do any other per-audio-run inits here
 
 		return true;
@@ -96,14 +146,16 @@ public:
 	virtual const SignalGenData renderAudioOutput()
 	{
 		SignalGenData generatorOutput;
-		NoiseGenData a;
-		SignalGenData b;
-		a = noiseGen.renderAudioOutput();
-		b = lfoEx.renderAudioOutput();
-		double lfoShaped = 0.0;
-		lfoShaped = b.normalOutput;
-		lfoShaped = atanWaveShaper(lfoShaped, Sysparameters.waveshaperSaturation);
-		generatorOutput.normalOutput = lfoShaped + a.filteredgaussianNoiseOut;
+		double noise = 0.0;
+		if (useNoiseTable)
+		{
+			// --- one load and one multiply
+			noise = noiseTable->read(noiseTableIndex) * Sysparameters.tapeNoiseAmplitude;
+			noiseTableIndex += noiseTableStride;
+		}
+		else
+			noise = filteredNoise(noiseGen.renderAudioOutput());
+		generatorOutput.normalOutput = renderHum() + noise;
 		return generatorOutput;
 	}
 
@@ -126,26 +178,152 @@ public:
 		//     and copy the variables one at a time, or you may test
 		//     to see if cook-able variables have changed; if not, then
 		//     do not re-cook them as it just wastes CPU
+		Sysparameters = _params;
 
-		LFO_ExParameters lfoParamsAF = lfoEx.getParameters();
-		lfoParamsAF.amplitude = Sysparameters.sixtyHzNoiseAmplitude;
-		lfoEx.setParameters(lfoParamsAF);
+		// --- the hum shape only depends on amplitude, saturation and harmonics; frequency is just the phase increment
+		humPhaseInc = sampleRate > 0.0 ? getMainsFrequency_Hz() / sampleRate : 0.0;
+		if (Sysparameters.sixtyHzNoiseAmplitude != humTableAmplitude ||
+			Sysparameters.waveshaperSaturation != humTableSaturation ||
+			Sysparameters.humHarmonics != humTableHarmonics)
+			renderHumTable();
 
 		NoiseGeneratorParameters noiseParams = noiseGen.getParameters();
 		noiseParams.lpf_fc_Hz = Sysparameters.tapeNoiseFc_Hz;
 		noiseParams.outputAmplitude = Sysparameters.tapeNoiseAmplitude;
+		noiseParams.requiredOutputs = filteredNoiseOutputFor(Sysparameters.noiseColour);
 		noiseGen.setParameters(noiseParams);
-		
-		Sysparameters = _params;
+
+		// --- a table no longer matching the settings can't be rebuilt here (audio thread);
+		//     fall back to live noise until the next reset
+		if (useNoiseTable && !noiseTable->matches(sampleRate, Sysparameters.tapeNoiseFc_Hz, Sysparameters.noiseColour, Sysparameters.noiseTableLength_Sec))
+			useNoiseTable = false;
 
 		// --- cook parameters here
 	}
 
+	/** bytes held by this instance's noise table; a shared table is counted by every user */
+	size_t getNoiseTableMemoryBytes()
+	{
+		return noiseTable ? noiseTable->getMemoryBytes() : 0;
+	}
+
+	/** arena bytes attachArena() will take: only a per-instance table lives in the arena */
+	size_t getArenaBytes(double maxSampleRate)
+	{
+		return getArenaBytes(maxSampleRate, Sysparameters);
+	}
+
+	/** the same for settings not (yet) applied */
+	static size_t getArenaBytes(double maxSampleRate, const SystemNoiseGenParameters& params)
+	{
+		if (params.noiseTableMode != NoiseTableMode::perInstance)
+			return 0;
+		return DSPArena::regionBytes<float>(NoiseLoopTable::getRequiredLength(maxSampleRate, params.noiseTableLength_Sec));
+	}
+
+	/** render the per-instance noise table into the arena instead of the heap */
+	void attachArena(DSPArena& arena, double maxSampleRate)
+	{
+		arenaNoiseTable = nullptr;
+		arenaNoiseTableLength = 0;
+		if (Sysparameters.noiseTableMode != NoiseTableMode::perInstance)
+			return;
+		uint32_t length = NoiseLoopTable::getRequiredLength(maxSampleRate, Sysparameters.noiseTableLength_Sec);
+		arenaNoiseTable = arena.allocate<float>(length, "SystemNoiseGen noise table");
+		arenaNoiseTableLength = arenaNoiseTable ? length : 0;
+	}
+
+	/** positions for state save/restore */
+	SystemNoiseGenState getState()
+	{
+		SystemNoiseGenState state;
+		state.humPhase = humPhase;
+		state.noiseTableIndex = noiseTableIndex;
+		state.reverseNoiseTable = noiseTable && noiseTableStride != 1;
+		return state;
+	}
+
+	/** restore positions after reset(); the direction is stored as a flag since the stride depends on the table length */
+	void setState(const SystemNoiseGenState& state)
+	{
+		humPhase = state.humPhase - floor(state.humPhase);
+		noiseTableIndex = state.noiseTableIndex;
+		if (noiseTable)
+			noiseTableStride = state.reverseNoiseTable ? noiseTable->getWrapMask() : 1;
+	}
+
+	/** true if the drift noise is currently read from a table */
+	bool isUsingNoiseTable() { return useNoiseTable; }
+
+protected:
+	double getMainsFrequency_Hz()
+	{
+		return Sysparameters.mainsFrequency == MainsFrequency::fiftyHz ? 50.0 : 60.0;
+	}
+
+	/** tabulate one cycle of (sine + harmonics) * amplitude through the atan waveshaper; no allocation */
+	void renderHumTable()
+	{
+		humTableAmplitude = Sysparameters.sixtyHzNoiseAmplitude;
+		humTableSaturation = Sysparameters.waveshaperSaturation;
+		humTableHarmonics = Sysparameters.humHarmonics;
+
+		// --- keep the pre-shaper peak at or below the amplitude however much harmonic content is mixed in
+		double harmonicNorm = 1.0 / (1.0 + humTableHarmonics * (0.5 + 0.3 + 0.15));
+		for (uint32_t i = 0; i < kHumTableLength; i++)
+		{
+			double theta = kTwoPi * (double)i / (double)kHumTableLength;
+			double x = sin(theta) + humTableHarmonics * (0.5 * sin(2.0 * theta) + 0.3 * sin(3.0 * theta) + 0.15 * sin(5.0 * theta));
+			humTable[i] = atanWaveShaper(x * harmonicNorm * humTableAmplitude, humTableSaturation);
+		}
+		humTable[kHumTableLength] = humTable[0]; ///< guard point for interpolation
+	}
+
+	/** one hum sample: table lookup with linear interpolation */
+	inline double renderHum()
+	{
+		double position = humPhase * kHumTableLength;
+		uint32_t index = (uint32_t)position;
+		double yn = doLinearInterpolation(humTable[index], humTable[index + 1], position - index);
+
+		humPhase += humPhaseInc;
+		if (humPhase >= 1.0)
+			humPhase -= 1.0;
+		return yn;
+	}
+
+	/** pick the filtered output matching the selected colour */
+	inline double filteredNoise(const NoiseGenData& data)
+	{
+		if (Sysparameters.noiseColour == NoiseColour::pink)
+			return data.filteredPinkNoiseOut;
+		if (Sysparameters.noiseColour == NoiseColour::white)
+			return data.filteredWhiteNoiseOut;
+		return data.filteredgaussianNoiseOut;
+	}
+
 private:
 	SystemNoiseGenParameters Sysparameters; ///< object parameters
-	LFO_Ex lfoEx;
 	NoiseGenerator noiseGen;
 
+	// --- tabulated hum cycle
+	static const uint32_t kHumTableLength = 2048;
+	double humTable[kHumTableLength + 1] = { 0.0 };
+	double humPhase = 0.0;
+	double humPhaseInc = 0.0;
+	double humTableAmplitude = 0.0;
+	double humTableSaturation = 0.0;
+	double humTableHarmonics = 0.0;
+
+	// --- pre-rendered drift noise
+	std::shared_ptr<const NoiseLoopTable> noiseTable = nullptr;
+	bool useNoiseTable = false;
+	uint32_t noiseTableIndex = 0;
+	uint32_t noiseTableStride = 1;
+	NoiseTableMode noiseTableMode = NoiseTableMode::off; ///< mode noiseTable was made for
+	float* arenaNoiseTable = nullptr;
+	uint32_t arenaNoiseTableLength = 0;
+
 	// --- local variables used by this object
 	double sampleRate = 0.0;	///< sample rate
 
@@ -0,0 +1,238 @@
+#pragma once
+
+#ifndef __TapeEchoDelay__
+#define __TapeEchoDelay__
+
+#include "fxobjects.h"
+#include "noisegen.h"
+#include "StereoTapeBuffer.h"
+
+/**
+\struct TapeEchoDelayParameters
+\ingroup FX-Objects
+\brief
+Custom parameter structure for the TapeEchoDelay object. Levels that PluginCore cooks once
+per change (noise, record, playback) arrive linear; wet and dry arrive in dB and are cooked
+here, only when they change.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+struct TapeEchoDelayParameters
+{
+	TapeEchoDelayParameters() {}
+
+	/** all FXObjects parameter objects require overloaded= operator so remember to add new entries if you add new variables. */
+	TapeEchoDelayParameters& operator=(const TapeEchoDelayParameters& params)	// need this override for collections to work
+	{
+		if (this == &params)
+			return *this;
+
+		interpolation = params.interpolation;
+		leftDelay_mSec = params.leftDelay_mSec;
+		rightDelay_mSec = params.rightDelay_mSec;
+		feedback_Pct = params.feedback_Pct;
+		wetLevel_dB = params.wetLevel_dB;
+		dryLevel_dB = params.dryLevel_dB;
+		noiseLevel = params.noiseLevel;
+		recordLevel = params.recordLevel;
+		playbackLevel = params.playbackLevel;
+		noiseFreq = params.noiseFreq;
+
+		// --- MUST be last
+		return *this;
+	}
+
+	// --- individual parameters
+	TapeInterpolation interpolation = TapeInterpolation::linear; ///< read head interpolator
+	double leftDelay_mSec = 0.0;	///< read head position; the modulator moves it every frame
+	double rightDelay_mSec = 0.0;
+	double feedback_Pct = 0.0;		///< playback back onto the tape
+	double wetLevel_dB = -3.0;
+	double dryLevel_dB = -3.0;
+	double noiseLevel = 0.0;		///< tape hiss recorded with the signal, linear
+	double recordLevel = 1.0;		///< gain onto the tape, linear
+	double playbackLevel = 1.0;		///< gain off the tape, linear
+	double noiseFreq = 1000.0;		///< hiss lowpass cutoff, Hz
+};
+
+/**
+\class TapeEchoDelay
+\ingroup FX-Objects
+\brief
+The Echoplex tape: a two track tape with a record head, a read head and a feedback loop.
+
+Per frame: each channel reads the tape at its (modulated, fractional) delay with the
+selected interpolator and scales it by the playback level; the input times the record level,
+plus the feedback and the hiss, is recorded; the output mixes the dry input and the playback
+at the wet and dry levels.
+
+The tape is one interleaved StereoTapeBuffer. The plugin drives both delays with the same
+modulator output, so the read is normally the linked one (one address and weight calculation
+for the pair); different left and right delays fall back to two channel reads.
+
+Audio I/O:
+- Processes mono input to mono output (left channel's settings; both tracks record it).
+- Processes stereo frames.
+
+Control I/F:
+- Use TapeEchoDelayParameters structure to get/set object params.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class TapeEchoDelay : public IAudioSignalProcessor
+{
+public:
+	TapeEchoDelay(void) { cookLevels(); }	/* C-TOR */
+	~TapeEchoDelay(void) {}	/* D-TOR */
+
+public:
+	/** reset members to initialized state: clear the tape (sizing is createDelayBuffers()' job) and restart the hiss */
+	virtual bool reset(double _sampleRate)
+	{
+		sampleRate = _sampleRate;
+		NoiseGeneratorParameters noiseParams = noiseGen.getParameters();
+		noiseParams.lpf_fc_Hz = parameters.noiseFreq;
+		noiseParams.requiredOutputs = kFilteredWhiteNoiseOut;
+		noiseGen.setParameters(noiseParams);
+		noiseGen.reset(_sampleRate);
+		if (samplesPerMSec > 0.0)
+			tape.flushBuffer();
+		return true;
+	}
+
+	/** size the tape for a rate and the longest delay; allocates only to grow */
+	void createDelayBuffers(double _sampleRate, double _bufferLength_mSec)
+	{
+		tape.createDelayBuffer(_sampleRate, _bufferLength_mSec);
+		samplesPerMSec = _sampleRate / 1000.0;
+		WindowedSincTable::get(); // --- built here, so selecting the sinc later never builds it on the audio thread
+	}
+
+	/** arena bytes attachArena() will take */
+	static size_t getArenaBytes(double maxSampleRate, double _bufferLength_mSec)
+	{
+		return StereoTapeBuffer::getArenaBytes(maxSampleRate, _bufferLength_mSec);
+	}
+
+	/** take the tape from the arena, sized for maxSampleRate; call before createDelayBuffers() */
+	void attachArena(DSPArena& arena, double maxSampleRate, double _bufferLength_mSec)
+	{
+		tape.attachArena(arena, maxSampleRate, _bufferLength_mSec);
+	}
+
+	/** process MONO input: the left channel */
+	virtual double processAudioSample(double xn)
+	{
+		double yn = 0.0, unused = 0.0;
+		tape.readFrameAtSamples(parameters.leftDelay_mSec * samplesPerMSec, yn, unused);
+		yn *= parameters.playbackLevel;
+		double record = xn * parameters.recordLevel + feedback * yn + renderHiss();
+		tape.writeFrame(record, record);
+		return dryLevel * xn + wetLevel * yn;
+	}
+
+	/** query to see if this object can process frames */
+	virtual bool canProcessAudioFrame() { return true; }
+
+	/** process a stereo frame (a mono input feeds both channels) */
+	virtual bool processAudioFrame(const float* inputFrame, float* outputFrame, uint32_t inputChannels, uint32_t outputChannels)
+	{
+		if (inputChannels == 0 || outputChannels == 0)
+			return false;
+		double xnL = inputFrame[0];
+		double xnR = inputChannels > 1 ? inputFrame[1] : xnL;
+
+		double ynL = 0.0, ynR = 0.0;
+		if (parameters.leftDelay_mSec == parameters.rightDelay_mSec)
+			tape.readFrameAtSamples(parameters.leftDelay_mSec * samplesPerMSec, ynL, ynR);
+		else
+			tape.readFrameAtSamples(parameters.leftDelay_mSec * samplesPerMSec, parameters.rightDelay_mSec * samplesPerMSec, ynL, ynR);
+		ynL *= parameters.playbackLevel;
+		ynR *= parameters.playbackLevel;
+
+		double hiss = renderHiss();
+		tape.writeFrame(xnL * parameters.recordLevel + feedback * ynL + hiss, xnR * parameters.recordLevel + feedback * ynR + hiss);
+
+		outputFrame[0] = (float)(dryLevel * xnL + wetLevel * ynL);
+		if (outputChannels > 1)
+			outputFrame[1] = (float)(dryLevel * xnR + wetLevel * ynR);
+		return true;
+	}
+
+	/** bytes held by the tape */
+	size_t getDelayMemoryBytes() { return tape.getDelayMemoryBytes(); }
+
+	/** append the written part of the tape, both tracks; see StereoTapeBuffer::saveSnapshot() */
+	void saveSnapshot(StateChunkWriter& writer) { tape.saveSnapshot(writer); }
+
+	/** replace the tape with a saveSnapshot(); after createDelayBuffers(), main thread, not while processing */
+	bool loadSnapshot(StateChunkReader& reader) { return tape.loadSnapshot(reader); }
+
+	/** get parameters: note use of custom structure for passing param data */
+	/**
+	\return TapeEchoDelayParameters custom data structure
+	*/
+	TapeEchoDelayParameters getParameters()
+	{
+		return parameters;
+	}
+
+	/** set parameters: note use of custom structure for passing param data; only what changed is re-cooked */
+	/**
+	\param TapeEchoDelayParameters custom data structure
+	*/
+	void setParameters(const TapeEchoDelayParameters& _params)
+	{
+		bool cookInterpolation = _params.interpolation != parameters.interpolation;
+		bool cookNoise = _params.noiseFreq != parameters.noiseFreq;
+		bool cook = _params.wetLevel_dB != parameters.wetLevel_dB || _params.dryLevel_dB != parameters.dryLevel_dB ||
+			_params.feedback_Pct != parameters.feedback_Pct;
+		parameters = _params;
+
+		if (cookInterpolation)
+		{
+			StereoTapeBufferParameters tapeParams = tape.getParameters();
+			tapeParams.interpolation = parameters.interpolation;
+			tape.setParameters(tapeParams);
+		}
+		if (cookNoise)
+		{
+			NoiseGeneratorParameters noiseParams = noiseGen.getParameters();
+			noiseParams.lpf_fc_Hz = parameters.noiseFreq;
+			noiseGen.setParameters(noiseParams);
+		}
+		if (cook)
+			cookLevels();
+	}
+
+protected:
+	void cookLevels()
+	{
+		wetLevel = pow(10.0, parameters.wetLevel_dB / 20.0);
+		dryLevel = pow(10.0, parameters.dryLevel_dB / 20.0);
+		feedback = parameters.feedback_Pct / 100.0;
+	}
+
+	inline double renderHiss()
+	{
+		return parameters.noiseLevel > 0.0 ? noiseGen.renderAudioOutput().filteredWhiteNoiseOut * parameters.noiseLevel : 0.0;
+	}
+
+private:
+	TapeEchoDelayParameters parameters; ///< object parameters
+	StereoTapeBuffer tape;		///< both tracks, interleaved
+	NoiseGenerator noiseGen;	///< hiss source
+
+	// --- cooked
+	double wetLevel = 0.0;
+	double dryLevel = 0.0;
+	double feedback = 0.0;
+
+	// --- local variables used by this object
+	double sampleRate = 0.0;	///< sample rate
+	double samplesPerMSec = 0.0; ///< 0 until createDelayBuffers()
+};
+
+#endif
@@ -0,0 +1,179 @@
+#pragma once
+
+#ifndef __TelemetryRing__
+#define __TelemetryRing__
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/** one decimated block of audio-thread state, as seen by the GUI */
+struct TelemetryFrame
+{
+	float peak[2] = { 0.f, 0.f };	///< per channel, linear
+	float rms[2] = { 0.f, 0.f };	///< per channel, linear
+	float delay_mSec = 0.f;			///< modulated delay time at the end of the block
+	float wow_mSec = 0.f;			///< delay_mSec minus the Delay Time setting: the wow and flutter alone
+	float noiseLevel = 0.f;			///< linear
+	uint32_t blockCount = 0;		///< running block number; a gap means frames were dropped
+};
+
+/**
+\class SPSCRing
+\ingroup FX-Objects
+\brief
+Wait-free single producer, single consumer ring of trivially copyable items.
+
+push() never blocks or allocates: when the ring is full (GUI closed, or not draining) the
+item is dropped and push() returns false. Head and tail live on separate cache lines so the
+two threads don't false-share. CAPACITY must be a power of two; one slot is kept empty.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+template <typename T, uint32_t CAPACITY>
+class SPSCRing
+{
+	static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "SPSCRing capacity must be a power of two");
+
+public:
+	/** producer only */
+	bool push(const T& item)
+	{
+		uint32_t head = writeIndex.load(std::memory_order_relaxed);
+		uint32_t next = (head + 1) & (CAPACITY - 1);
+		if (next == readIndex.load(std::memory_order_acquire))
+			return false;
+		items[head] = item;
+		writeIndex.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/** consumer only */
+	bool pop(T& item)
+	{
+		uint32_t tail = readIndex.load(std::memory_order_relaxed);
+		if (tail == writeIndex.load(std::memory_order_acquire))
+			return false;
+		item = items[tail];
+		readIndex.store((tail + 1) & (CAPACITY - 1), std::memory_order_release);
+		return true;
+	}
+
+private:
+	// --- padded rather than alignas: PluginCore is heap allocated, and C++14 new doesn't honour over-alignment
+	std::atomic<uint32_t> writeIndex{ 0 };
+	uint8_t padWrite[64 - sizeof(std::atomic<uint32_t>)];
+	std::atomic<uint32_t> readIndex{ 0 };
+	uint8_t padRead[64 - sizeof(std::atomic<uint32_t>)];
+	T items[CAPACITY];
+};
+
+/**
+\class TelemetryRecorder
+\ingroup FX-Objects
+\brief
+Audio-thread side of the telemetry path: accumulates per-channel peak and sum of squares for
+a block of frames (about kTelemetryRate_Hz blocks per second), then pushes one TelemetryFrame
+into the ring. Per frame it costs two compares, two multiply-adds and a counter.
+
+The GUI side calls drain() from its timer; it folds everything queued since the last call into
+one frame (peaks held, the rest from the newest block).
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class TelemetryRecorder
+{
+public:
+	static const uint32_t kRingCapacity = 256;	///< > 1 second of blocks; the GUI timer drains far more often
+	static constexpr double kTelemetryRate_Hz = 200.0;
+
+	/** audio thread reset(); the consumer must not be draining concurrently with a rate change */
+	void reset(double sampleRate)
+	{
+		double blockLength = sampleRate / kTelemetryRate_Hz;
+		framesPerBlock = blockLength < 1.0 ? 1 : (uint32_t)blockLength;
+		inverseFramesPerBlock = 1.f / (float)framesPerBlock;
+		clearBlock();
+	}
+
+	/** audio thread, once per output frame */
+	inline void recordFrame(float left, float right)
+	{
+		float absLeft = fabsf(left);
+		float absRight = fabsf(right);
+		if (absLeft > block.peak[0]) block.peak[0] = absLeft;
+		if (absRight > block.peak[1]) block.peak[1] = absRight;
+		sumOfSquares[0] += left * left;
+		sumOfSquares[1] += right * right;
+		if (++framesInBlock >= framesPerBlock)
+			pushBlock();
+	}
+
+	/** audio thread: latest modulation state, picked up by the next block */
+	inline void recordModulation(double delay_mSec, double wow_mSec, double noiseLevel)
+	{
+		block.delay_mSec = (float)delay_mSec;
+		block.wow_mSec = (float)wow_mSec;
+		block.noiseLevel = (float)noiseLevel;
+	}
+
+	/** GUI thread: fold every queued block into latest; false if nothing arrived */
+	bool drain(TelemetryFrame& latest)
+	{
+		TelemetryFrame frame;
+		bool received = false;
+		while (ring.pop(frame))
+		{
+			if (!received)
+			{
+				latest = frame;
+				received = true;
+				continue;
+			}
+			for (int channel = 0; channel < 2; channel++)
+				frame.peak[channel] = frame.peak[channel] > latest.peak[channel] ? frame.peak[channel] : latest.peak[channel];
+			latest = frame;
+		}
+		return received;
+	}
+
+	/**
+	GUI thread, when the editor opens: drop what queued while nobody was draining - the first
+	second or so after the last close, which the ring kept and then stopped accepting newer
+	blocks behind
+	*/
+	void discard()
+	{
+		TelemetryFrame frame;
+		while (ring.pop(frame)) {}
+	}
+
+private:
+	void pushBlock()
+	{
+		block.rms[0] = sqrtf(sumOfSquares[0] * inverseFramesPerBlock);
+		block.rms[1] = sqrtf(sumOfSquares[1] * inverseFramesPerBlock);
+		block.blockCount = blockCount++;
+		ring.push(block); // --- full ring: drop it, nobody is watching
+		clearBlock();
+	}
+
+	void clearBlock()
+	{
+		block.peak[0] = block.peak[1] = 0.f;
+		sumOfSquares[0] = sumOfSquares[1] = 0.f;
+		framesInBlock = 0;
+	}
+
+	SPSCRing<TelemetryFrame, kRingCapacity> ring;
+	TelemetryFrame block;
+	float sumOfSquares[2] = { 0.f, 0.f };
+	float inverseFramesPerBlock = 1.f;
+	uint32_t framesInBlock = 0;
+	uint32_t framesPerBlock = 1;
+	uint32_t blockCount = 0;
+};
+
+#endif
@@ -146,6 +146,19 @@ public:
 		// --- cook parameters here
 	}
 
+	/** the three LFO positions; reset() randomizes them, these put them back */
+	void getPhases(double phases[3])
+	{
+		for (int i = 0; i < 3; i++)
+			phases[i] = lfoEx[i].getPhase();
+	}
+
+	void setPhases(const double phases[3])
+	{
+		for (int i = 0; i < 3; i++)
+			lfoEx[i].setPhase(phases[i]);
+	}
+
 private:
 	TrippleLFOParameters Tparameters; ///< object parameters
 	LFO_Ex lfoEx[3];
@@ -0,0 +1,443 @@
+#pragma once
+
+#ifndef __UIDescriptionCache__
+#define __UIDescriptionCache__
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#include <process.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+\class UIDescriptionCache
+\ingroup FX-Objects
+\brief
+Splits a RackAFX-exported .uidesc into a compact layout file plus one PNG per bitmap.
+
+The exported PluginGUI.uidesc carries every bitmap inline as base64 - over 99% of its 7,800
+lines - so each editor open re-parses and re-decodes all of them. compile() writes:
+
+- PluginGUI.layout.uidesc: the same description with the <data> blocks removed and every
+  bitmap path pointing at a decoded PNG beside it (the exported paths are absolute ones from
+  the designer's machine, e.g. \\Mac\Home\Desktop\LiquidGUI.png)
+- the decoded PNGs
+
+VSTGUI then parses a few kilobytes of XML and only loads a bitmap when a view first uses it.
+
+The output goes to a per-user cache folder (never the install folder), in a subfolder named
+by a hash of the uidesc text, so the source can be the resource embedded in the binary as
+well as a loose file: a new build with a changed GUI gets a new folder, and an unchanged
+one finds its layout already there.
+
+start() reads and compiles on a worker thread, once per process; getLayoutFile() never
+waits for it and returns an empty string until the layout is ready (or if anything failed),
+in which case the caller opens the original uidesc, so the editor always opens and the
+message thread never decodes bitmaps. post() queues other editor work (pre-rendering Scale
+GUI bitmaps, see ScaledBitmapCache) on the same worker: jobs run in order, and the worker
+exits when the queue is empty and is started again by the next post().
+
+The worker is joined when the module unloads (the process-wide State is a function-local
+static, so its destructor runs with the module's other statics); on Windows the worker also
+holds a reference on the module until it exits, so that join never waits on a thread that
+still needs the loader lock.
+
+\version Revision : 1.3
+\date Date : 2019 / 01 / 31
+*/
+class UIDescriptionCache
+{
+public:
+	/** fills its argument with the uidesc text; false if there is none */
+	typedef std::function<bool(std::string&)> SourceReader;
+
+	/** begin reading and compiling on the worker thread; calls after the first do nothing */
+	static void start(SourceReader readSource)
+	{
+		{
+			State& state = getState();
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (state.started)
+				return;
+			state.started = true;
+		}
+		post([readSource]()
+		{
+			std::string source;
+			std::string layoutPath;
+			if (readSource(source))
+				layoutPath = getCachedLayout(source, getUserCacheDirectory());
+
+			State& state = getState();
+			std::lock_guard<std::mutex> lock(state.mutex);
+			state.layoutPath = layoutPath;
+			state.ready = true;
+		});
+	}
+
+	/** run a job on the worker thread, after the ones already queued; never waits for it */
+	static void post(std::function<void()> job)
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.jobs.push_back(std::move(job));
+		if (state.workerRunning)
+			return;
+
+		// --- the last worker found the queue empty and is on its way out
+		if (state.worker.joinable())
+			state.worker.join();
+		state.workerRunning = true;
+		state.worker = std::thread(runJobs);
+	}
+
+	/** path of the compiled layout; empty while the worker runs, or if it failed */
+	static std::string getLayoutFile()
+	{
+		State& state = getState();
+		if (!state.ready)
+			return std::string();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		return state.layoutPath;
+	}
+
+	/**
+	<cacheDirectory>/<hash of source>/PluginGUI.layout.uidesc, compiled if it isn't there yet;
+	empty if it can't be written
+	*/
+	static std::string getCachedLayout(const std::string& source, const std::string& cacheDirectory)
+	{
+		if (source.empty() || cacheDirectory.empty())
+			return std::string();
+
+		char hash[17];
+		snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)hashText(source));
+		std::string outputDirectory = joinPath(cacheDirectory, hash);
+		std::string layoutPath = joinPath(outputDirectory, "PluginGUI.layout.uidesc");
+
+		// --- the layout is written last, and atomically, so if it exists the bitmaps do too
+		if (fileExists(layoutPath))
+			return layoutPath;
+		if (!makeDirectories(outputDirectory) || !compile(source, outputDirectory, layoutPath))
+			return std::string();
+		return layoutPath;
+	}
+
+	/**
+	write the layout (to layoutPath) and the bitmaps (to outputDirectory, which the layout's
+	bitmap paths then name); each file is written to a temporary name unique to this process
+	and call, then renamed over the target in one step, so a concurrently starting process
+	never sees half a file and two processes compiling at once never share a temporary
+
+	\return false if the source is malformed or an output can't be written
+	*/
+	static bool compile(const std::string& source, const std::string& outputDirectory, const std::string& layoutPath)
+	{
+		std::string layout;
+		layout.reserve(source.size() / 16);
+		size_t position = 0;
+		for (;;)
+		{
+			size_t bitmapStart = source.find("<bitmap ", position);
+			if (bitmapStart == std::string::npos)
+				break;
+			size_t tagEnd = source.find('>', bitmapStart);
+			if (tagEnd == std::string::npos)
+				return false;
+			layout.append(source, position, bitmapStart - position);
+
+			std::string name = getAttribute(source, bitmapStart, tagEnd, "name");
+			std::string fileName = getFileName(getAttribute(source, bitmapStart, tagEnd, "path"));
+			if (fileName.empty())
+				fileName = name + ".png";
+
+			// --- copy the tag with its path pointing into the cache, dropping any inline data
+			bool selfClosing = source[tagEnd - 1] == '/';
+			std::string tag = source.substr(bitmapStart, tagEnd + 1 - bitmapStart);
+			setAttribute(tag, "path", joinPath(outputDirectory, fileName));
+			if (!selfClosing)
+				tag.insert(tag.size() - 1, " /");
+			layout += tag;
+			position = tagEnd + 1;
+			if (selfClosing)
+				continue;
+
+			size_t bitmapEnd = source.find("</bitmap>", position);
+			if (bitmapEnd == std::string::npos)
+				return false;
+			size_t dataStart = source.find("<data", position);
+			if (dataStart != std::string::npos && dataStart < bitmapEnd)
+			{
+				size_t payloadStart = source.find('>', dataStart);
+				size_t payloadEnd = source.find("</data>", dataStart);
+				if (payloadStart == std::string::npos || payloadEnd == std::string::npos || payloadEnd > bitmapEnd)
+					return false;
+				std::vector<uint8_t> png;
+				decodeBase64(source, payloadStart + 1, payloadEnd, png);
+				if (!writeFileAtomically(joinPath(outputDirectory, fileName), png.data(), png.size()))
+					return false;
+			}
+			position = bitmapEnd + 9; // --- past </bitmap>
+		}
+		layout.append(source, position, std::string::npos);
+		return writeFileAtomically(layoutPath, (const uint8_t*)layout.data(), layout.size());
+	}
+
+	/** the per-user cache folder for this plugin: %LOCALAPPDATA%, ~/Library/Caches or $XDG_CACHE_HOME; empty if unknown */
+	static std::string getUserCacheDirectory()
+	{
+#if defined(_WIN32)
+		const char* base = getenv("LOCALAPPDATA");
+		return base && *base ? joinPath(joinPath(base, "Echoplex"), "UICache") : std::string();
+#elif defined(__APPLE__)
+		const char* home = getenv("HOME");
+		return home && *home ? joinPath(home, "Library/Caches/Echoplex") : std::string();
+#else
+		const char* base = getenv("XDG_CACHE_HOME");
+		if (base && *base)
+			return joinPath(base, "echoplex");
+		const char* home = getenv("HOME");
+		return home && *home ? joinPath(home, ".cache/echoplex") : std::string();
+#endif
+	}
+
+	/** read a whole file; false if it can't be opened */
+	static bool readFile(const std::string& path, std::string& contents)
+	{
+		std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+		if (!file)
+			return false;
+		std::ostringstream buffer;
+		buffer << file.rdbuf();
+		contents = buffer.str();
+		return true;
+	}
+
+	/** decode [begin, end) of text, skipping whitespace and stopping at padding */
+	static void decodeBase64(const std::string& text, size_t begin, size_t end, std::vector<uint8_t>& output)
+	{
+		output.clear();
+		output.reserve((end - begin) * 3 / 4);
+		uint32_t accumulator = 0;
+		int bits = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			int value = base64Value(text[i]);
+			if (value == -2)
+				break; // --- '='
+			if (value < 0)
+				continue;
+			accumulator = (accumulator << 6) | (uint32_t)value;
+			bits += 6;
+			if (bits >= 8)
+			{
+				bits -= 8;
+				output.push_back((uint8_t)(accumulator >> bits));
+			}
+		}
+	}
+
+private:
+	static int base64Value(char c)
+	{
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+') return 62;
+		if (c == '/') return 63;
+		if (c == '=') return -2;
+		return -1;
+	}
+
+	/** value of name="..." inside the tag [tagStart, tagEnd) */
+	static std::string getAttribute(const std::string& text, size_t tagStart, size_t tagEnd, const char* name)
+	{
+		std::string key = std::string(" ") + name + "=\"";
+		size_t start = text.find(key, tagStart);
+		if (start == std::string::npos || start > tagEnd)
+			return std::string();
+		start += key.size();
+		size_t end = text.find('"', start);
+		return end == std::string::npos || end > tagEnd ? std::string() : text.substr(start, end - start);
+	}
+
+	static void setAttribute(std::string& tag, const char* name, const std::string& value)
+	{
+		std::string key = std::string(" ") + name + "=\"";
+		size_t start = tag.find(key);
+		if (start == std::string::npos)
+		{
+			size_t close = tag[tag.size() - 2] == '/' ? tag.size() - 2 : tag.size() - 1;
+			tag.insert(close, key.substr(1) + value + "\" ");
+			return;
+		}
+		start += key.size();
+		size_t end = tag.find('"', start);
+		tag.replace(start, end - start, value);
+	}
+
+	/** last component of a Windows or POSIX path */
+	static std::string getFileName(const std::string& path)
+	{
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? path : path.substr(separator + 1);
+	}
+
+	static std::string joinPath(const std::string& directory, const std::string& fileName)
+	{
+#if defined(_WIN32)
+		return directory.empty() ? fileName : directory + "\\" + fileName;
+#else
+		return directory.empty() ? fileName : directory + "/" + fileName;
+#endif
+	}
+
+	static bool fileExists(const std::string& path)
+	{
+		struct stat info;
+		return stat(path.c_str(), &info) == 0;
+	}
+
+	/** create path and any missing parents */
+	static bool makeDirectories(const std::string& path)
+	{
+		if (path.empty() || fileExists(path))
+			return true;
+		size_t separator = path.find_last_of("/\\");
+		if (separator != std::string::npos && separator > 0 && !makeDirectories(path.substr(0, separator)))
+			return false;
+#if defined(_WIN32)
+		return _mkdir(path.c_str()) == 0 || fileExists(path);
+#else
+		return mkdir(path.c_str(), 0755) == 0 || fileExists(path);
+#endif
+	}
+
+	/** FNV-1a, 64 bit */
+	static uint64_t hashText(const std::string& text)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : text)
+			hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+		return hash;
+	}
+
+	/** <path>.<pid>.<n>.tmp: unique across processes (pid) and across calls in this one (n) */
+	static std::string getTemporaryPath(const std::string& path)
+	{
+		static std::atomic<uint32_t> counter { 0 };
+#if defined(_WIN32)
+		unsigned long processID = (unsigned long)_getpid();
+#else
+		unsigned long processID = (unsigned long)getpid();
+#endif
+		char suffix[48];
+		snprintf(suffix, sizeof(suffix), ".%lu.%u.tmp", processID, (unsigned)counter.fetch_add(1));
+		return path + suffix;
+	}
+
+	/** replace target with source in one step; readers see the old file or the new one, never neither */
+	static bool replaceFile(const std::string& source, const std::string& target)
+	{
+#if defined(_WIN32)
+		// --- the narrow paths are in the ANSI code page, like the fopen()/_mkdir() calls that made them
+		std::wstring wideSource(MultiByteToWideChar(CP_ACP, 0, source.c_str(), -1, nullptr, 0), L'\0');
+		std::wstring wideTarget(MultiByteToWideChar(CP_ACP, 0, target.c_str(), -1, nullptr, 0), L'\0');
+		if (wideSource.empty() || wideTarget.empty())
+			return false;
+		MultiByteToWideChar(CP_ACP, 0, source.c_str(), -1, &wideSource[0], (int)wideSource.size());
+		MultiByteToWideChar(CP_ACP, 0, target.c_str(), -1, &wideTarget[0], (int)wideTarget.size());
+		return MoveFileExW(wideSource.c_str(), wideTarget.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(source.c_str(), target.c_str()) == 0; // --- atomic replace on POSIX
+#endif
+	}
+
+	static bool writeFileAtomically(const std::string& path, const uint8_t* data, size_t size)
+	{
+		std::string temporaryPath = getTemporaryPath(path);
+		FILE* file = fopen(temporaryPath.c_str(), "wb");
+		if (!file)
+			return false;
+		bool ok = fwrite(data, 1, size, file) == size;
+		ok = fclose(file) == 0 && ok;
+		ok = ok && replaceFile(temporaryPath, path);
+		if (!ok)
+			remove(temporaryPath.c_str());
+		return ok;
+	}
+
+	/** the worker: jobs until the queue is empty */
+	static void runJobs()
+	{
+#if defined(_WIN32)
+		// --- pin the module so it can't unload under us; released as the thread exits
+		HMODULE module = nullptr;
+		GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)&UIDescriptionCache::getState, &module);
+#endif
+		State& state = getState();
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				if (state.jobs.empty())
+				{
+					state.workerRunning = false;
+					break;
+				}
+				job = std::move(state.jobs.front());
+				state.jobs.pop_front();
+			}
+			job();
+		}
+#if defined(_WIN32)
+		if (module)
+			FreeLibraryAndExitThread(module, 0);
+#endif
+	}
+
+	/** the process-wide worker, its queue and the layout; destroyed, and the worker joined, at module unload */
+	struct State
+	{
+		~State()
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+
+		std::mutex mutex;
+		std::thread worker;
+		std::deque<std::function<void()>> jobs;
+		bool workerRunning = false;
+		bool started = false;
+		std::atomic<bool> ready { false };
+		std::string layoutPath;
+	};
+
+	static State& getState()
+	{
+		static State state;
+		return state;
+	}
+};
+
+#endif
@@ -4,6 +4,8 @@
 #define __UCombFilter__
 
 #include "fxobjects.h"
+#include "DSPArena.h"
+#include "StateChunk.h"
 
 /**
 \struct UCombFilterParameters
@@ -38,6 +40,7 @@ struct UCombFilterParameters
 		feedbackGain = params.feedbackGain;
 		dryGain = params.dryGain;
 		wetGain = params.wetGain;
+		maxDelayTime_mSec = params.maxDelayTime_mSec;
 		// --- MUST be last
 		return *this;
 	}
@@ -45,10 +48,11 @@ struct UCombFilterParameters
 	// --- individual parameters
 
 	CombFilterType combFilterType = CombFilterType::combFilter;
-	double delayTime_mSec = 0.0; ///< delay time in mSec
+	double delayTime_mSec = 0.0; ///< delay time in mSec, >= 0 (negative values read as 0)
 	double feedbackGain = 0.0; ///< feedback for comb filter
 	double dryGain = 0.5; ///< gain
 	double wetGain = 0.5; ///< gain 
+	double maxDelayTime_mSec = 500.0; ///< buffer capacity, applied on reset; size it from the real delay range
 };
 
 
@@ -56,7 +60,16 @@ struct UCombFilterParameters
 \class UCombFilter
 \ingroup FX-Objects
 \brief
-The UCombFilter object implements ....
+The UCombFilter object implements a feedforward (inverse) or feedback comb filter with a
+linearly interpolated delay.
+
+The delay is cooked into integer + fraction samples in setParameters() rather than per sample,
+and runs on a power-of-two ring buffer indexed with a mask. The filter type is also cooked
+into coefficients (feedback = 0 for the inverse comb, dry = 0 for the comb) and a block kernel
+picked when the type is set, so neither path tests the type per sample.
+
+The delay is clamped to [0, capacity] when cooked. SimpleDelay, which this replaced, did not
+clamp a negative delay, so the two only agree for delayTime_mSec >= 0; callers keep it there.
 
 Audio I/O:
 - Processes mono input to mono output.
@@ -77,18 +90,31 @@ public:
 	~UCombFilter(void) {}	/* D-TOR */
 
 public:
-	/** reset members to initialized state */
+	/**
+	reset members to initialized state: reconfigure (allocate) only if the ring has to grow,
+	otherwise just clear what was written since the last reset
+	*/
 	virtual bool reset(double _sampleRate)
 	{
 		// --- store the sample rate
 		sampleRate = (_sampleRate);
 
 		// --- do any other per-audio-run inits here
-		combDelayLine.createDelayBuffer(_sampleRate, 500.0);
-		combDelayLine.reset(_sampleRate);
+		if (getRequiredLength(_sampleRate, UParameters.maxDelayTime_mSec) > bufferCapacity)
+			createDelayBuffer(_sampleRate, UParameters.maxDelayTime_mSec);
+		else
+			reconfigureDelayBuffer(_sampleRate, UParameters.maxDelayTime_mSec);
+		cookParameters();
 		return true;
 	}
 
+	/** zero only the part of the ring written since the last clear */
+	void clearDelay()
+	{
+		clearWrittenRegion(delayBuffer, bufferLength, writeIndex, samplesWritten);
+		samplesWritten = 0;
+	}
+
 	/** process MONO input */
 	/**
 	\param xn input
@@ -96,32 +122,78 @@ public:
 	*/
 	virtual double processAudioSample(double xn)
 	{
-	
-		// --- the output variable
-		double yn = 0.0;
-
-		// --- do your DSP magic here to create yn
-		double delayedSample = 0.0;
-		if (UParameters.combFilterType == CombFilterType::inverseCombFilter) {
-			delayedSample = combDelayLine.readDelayAtTime_mSec(UParameters.delayTime_mSec);
-			combDelayLine.writeDelay(xn);
-			double drySignal = xn * UParameters.dryGain;
-			double wetSignal = delayedSample * UParameters.wetGain;
-			yn = wetSignal + drySignal;
-		}
-		if (UParameters.combFilterType == CombFilterType::combFilter) {
-			delayedSample = combDelayLine.readDelayAtTime_mSec(UParameters.delayTime_mSec);
-			combDelayLine.writeDelay(xn + delayedSample * UParameters.feedbackGain);
-			double wetSignal = delayedSample * UParameters.wetGain;
-			yn = wetSignal;
-		}
-		// --- done
-  		return yn;
+		// --- branch-free: the type lives in the cooked coefficients
+		double delayedSample = readDelay();
+		writeDelay(xn + delayedSample * feedbackCoeff);
+		return xn * dryCoeff + delayedSample * wetCoeff;
+	}
+
+	/** process a block of MONO samples with the kernel chosen for the current type; in-place is fine */
+	void processAudioBlock(const double* input, double* output, uint32_t numSamples)
+	{
+		(this->*blockKernel)(input, output, numSamples);
 	}
 
 	/** query to see if this object can process frames */
 	virtual bool canProcessAudioFrame() { return false; } // <-- change this!
 
+	/** bytes held by the delay line */
+	size_t getDelayMemoryBytes() { return bufferLength * sizeof(double); }
+
+	/** append the ring's written part, oldest sample first, as raw doubles */
+	void saveSnapshot(StateChunkWriter& writer)
+	{
+		uint32_t count = samplesWritten < bufferLength ? (uint32_t)samplesWritten : bufferLength;
+		uint32_t start = (writeIndex - count) & wrapMask;
+		uint32_t firstSpan = count < bufferLength - start ? count : bufferLength - start;
+		writer.writeValue(count);
+		writer.writeArray(delayBuffer + start, firstSpan);
+		writer.writeArray(delayBuffer, count - firstSpan);
+	}
+
+	/**
+	clear, then copy a saveSnapshot() back in; a longer snapshot (saved at a higher rate) keeps its
+	newest samples. Main thread, after reset(), not while processing.
+	*/
+	bool loadSnapshot(StateChunkReader& reader)
+	{
+		uint32_t count = 0;
+		if (!delayBuffer || !reader.readValue(count))
+			return false;
+		clearDelay();
+		uint32_t skip = count > bufferLength ? count - bufferLength : 0;
+		if (!reader.skip<double>(skip) || !reader.readArray(delayBuffer, count - skip))
+			return false;
+		writeIndex = (count - skip) & wrapMask;
+		samplesWritten = count - skip;
+		return true;
+	}
+
+	/** ring length (power of two) for a rate and max delay */
+	static uint32_t getRequiredLength(double _sampleRate, double _bufferLength_mSec)
+	{
+		// --- +2: one for the interpolation neighbour, one so the max delay never reads the write slot
+		uint32_t minLength = (uint32_t)(_bufferLength_mSec * _sampleRate / 1000.0) + 2;
+		uint32_t length = 1;
+		while (length < minLength)
+			length <<= 1;
+		return length;
+	}
+
+	/** arena bytes attachArena() will take */
+	static size_t getArenaBytes(double maxSampleRate, double _bufferLength_mSec)
+	{
+		return DSPArena::regionBytes<double>(getRequiredLength(maxSampleRate, _bufferLength_mSec));
+	}
+
+	/** take the delay line from the arena, sized for maxSampleRate; reset() then never allocates */
+	void attachArena(DSPArena& arena, double maxSampleRate, double _bufferLength_mSec)
+	{
+		uint32_t length = getRequiredLength(maxSampleRate, _bufferLength_mSec);
+		arenaBuffer = arena.allocate<double>(length, "UCombFilter delay");
+		arenaLength = arenaBuffer ? length : 0;
+	}
+
 	/** process audio frame: implement this function if you answer "true" to above query */
 	virtual bool processAudioFrame(const float* inputFrame,	/* ptr to one frame of data: pInputFrame[0] = left, pInputFrame[1] = right, etc...*/
 					     float* outputFrame,
@@ -152,29 +224,151 @@ public:
 		//     and copy the variables one at a time, or you may test
 		//     to see if cook-able variables have changed; if not, then
 		//     do not re-cook them as it just wastes CPU
-		//createDelayBuffer(sampleRate, UParameters.delayTime_mSec);
-		
+		bool cook = _params.delayTime_mSec != UParameters.delayTime_mSec ||
+					_params.combFilterType != UParameters.combFilterType ||
+					_params.feedbackGain != UParameters.feedbackGain ||
+					_params.dryGain != UParameters.dryGain ||
+					_params.wetGain != UParameters.wetGain;
+
 		UParameters = _params;
 
 		// --- cook parameters here
+		if (cook)
+			cookParameters();
 	}
 
 private:
 	void createDelayBuffer(double _sampleRate, double _bufferLength_mSec)
 	{
 		// --- store for math
-		//bufferLength_mSec = _bufferLength_mSec;
 		sampleRate = _sampleRate;
-		// --- create new buffer
-		combDelayLine.createDelayBuffer(_sampleRate, _bufferLength_mSec);
+		samplesPerMSec = sampleRate / 1000.0;
+
+		bufferLength = getRequiredLength(sampleRate, _bufferLength_mSec);
+		wrapMask = bufferLength - 1;
+
+		// --- arena region if it's big enough, else our own buffer
+		if (bufferLength <= arenaLength)
+		{
+			ownedBuffer = nullptr;
+			delayBuffer = arenaBuffer;
+			bufferCapacity = arenaLength;
+			clearWrittenRegion(delayBuffer, bufferCapacity, 0, bufferCapacity);
+		}
+		else
+		{
+			ownedBuffer.reset(new double[bufferLength]);
+			delayBuffer = ownedBuffer.get();
+			bufferCapacity = bufferLength;
+			memset(delayBuffer, 0, bufferLength * sizeof(double));
+		}
+		writeIndex = 0;
+		samplesWritten = 0;
 	}
+
+	/** new rate/length within the current capacity: clear the dirty region (in the old geometry), no allocation */
+	void reconfigureDelayBuffer(double _sampleRate, double _bufferLength_mSec)
+	{
+		clearDelay();
+		sampleRate = _sampleRate;
+		samplesPerMSec = sampleRate / 1000.0;
+		bufferLength = getRequiredLength(sampleRate, _bufferLength_mSec);
+		wrapMask = bufferLength - 1;
+		writeIndex = 0;
+	}
+
+	/** delay -> int/frac samples, type -> coefficients and block kernel */
+	void cookParameters()
+	{
+		double delayInSamples = UParameters.delayTime_mSec * samplesPerMSec;
+		boundValue(delayInSamples, 0.0, (double)bufferLength - 2.0);
+		delayInt = (uint32_t)delayInSamples;
+		delayFrac = delayInSamples - delayInt;
+
+		if (UParameters.combFilterType == CombFilterType::combFilter)
+		{
+			feedbackCoeff = UParameters.feedbackGain;
+			dryCoeff = 0.0;
+			blockKernel = &UCombFilter::combKernel<true>;
+		}
+		else
+		{
+			feedbackCoeff = 0.0;
+			dryCoeff = UParameters.dryGain;
+			blockKernel = &UCombFilter::combKernel<false>;
+		}
+		wetCoeff = UParameters.wetGain;
+	}
+
+	/** x(n - delay), linear interpolation between the two cached neighbours */
+	inline double readDelay()
+	{
+		double y1 = delayBuffer[(writeIndex - delayInt) & wrapMask];
+		double y2 = delayBuffer[(writeIndex - delayInt - 1) & wrapMask];
+		return y1 + delayFrac * (y2 - y1);
+	}
+
+	inline void writeDelay(double xn)
+	{
+		delayBuffer[writeIndex] = xn;
+		writeIndex = (writeIndex + 1) & wrapMask;
+		samplesWritten++;
+	}
+
+	/** block kernel; FEEDBACK selects comb vs. inverse comb at compile time */
+	template <bool FEEDBACK>
+	void combKernel(const double* input, double* output, uint32_t numSamples)
+	{
+		double* buffer = delayBuffer;
+		uint32_t index = writeIndex;
+		for (uint32_t i = 0; i < numSamples; i++)
+		{
+			double y1 = buffer[(index - delayInt) & wrapMask];
+			double y2 = buffer[(index - delayInt - 1) & wrapMask];
+			double delayedSample = y1 + delayFrac * (y2 - y1);
+			double xn = input[i];
+			if (FEEDBACK)
+			{
+				buffer[index] = xn + delayedSample * feedbackCoeff;
+				output[i] = delayedSample * wetCoeff;
+			}
+			else
+			{
+				buffer[index] = xn;
+				output[i] = xn * dryCoeff + delayedSample * wetCoeff;
+			}
+			index = (index + 1) & wrapMask;
+		}
+		writeIndex = index;
+		samplesWritten += numSamples;
+	}
+
 	UCombFilterParameters parameters; ///< object parameters
 
 	// --- local variables used by this object
 	double sampleRate = 0.0;	///< sample rate
-	SimpleDelay combDelayLine;
+	double samplesPerMSec = 0.0;
 	UCombFilterParameters UParameters;
 
+	// --- power-of-two ring buffer
+	double* delayBuffer = nullptr; ///< arenaBuffer or ownedBuffer
+	std::unique_ptr<double[]> ownedBuffer = nullptr;
+	double* arenaBuffer = nullptr;
+	uint32_t arenaLength = 0;
+	uint32_t bufferCapacity = 0; ///< allocated length; bufferLength <= bufferCapacity
+	uint64_t samplesWritten = 0; ///< since the last clear; bounds the region clearDelay() touches
+	uint32_t bufferLength = 0;
+	uint32_t wrapMask = 0;
+	uint32_t writeIndex = 0;
+
+	// --- cooked
+	uint32_t delayInt = 0;
+	double delayFrac = 0.0;
+	double feedbackCoeff = 0.0;
+	double dryCoeff = 0.0;
+	double wetCoeff = 0.5;
+	void (UCombFilter::*blockKernel)(const double*, double*, uint32_t) = &UCombFilter::combKernel<true>;
+
 };
 
 #endif
\ No newline at end of file
@@ -5,21 +5,135 @@
 
 #include "fxobjects.h"
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 enum class NoiseType { whiteNoise, filteredWhiteNoise };
 
+/** noise colour choice for objects that consume one filtered NoiseGenerator output */
+enum class NoiseColour { white, gaussian, pink };
+
+/** bitmask of NoiseGenData outputs a NoiseGenerator is asked to render; anything not requested is left at 0.0 and costs nothing */
+enum noiseGenOutput : uint32_t
+{
+	kWhiteNoiseOut = 1 << 0,
+	kFilteredWhiteNoiseOut = 1 << 1,
+	kGaussianNoiseOut = 1 << 2,
+	kFilteredGaussianNoiseOut = 1 << 3,
+	kPinkNoiseOut = 1 << 4,
+	kFilteredPinkNoiseOut = 1 << 5,
+	kAllNoiseOutputs = kWhiteNoiseOut | kFilteredWhiteNoiseOut | kGaussianNoiseOut | kFilteredGaussianNoiseOut | kPinkNoiseOut | kFilteredPinkNoiseOut
+};
+
+/** the filtered NoiseGenData output flag for a given colour */
+inline uint32_t filteredNoiseOutputFor(NoiseColour colour)
+{
+	if (colour == NoiseColour::white) return kFilteredWhiteNoiseOut;
+	if (colour == NoiseColour::pink) return kFilteredPinkNoiseOut;
+	return kFilteredGaussianNoiseOut;
+}
+
 struct NoiseGenData 
 {
 	NoiseGenData() {}
 
 	double whiteNoiseOut = 0.0;
 	double filteredWhiteNoiseOut = 0.0;
-	double pinkNoiseOut = 0.0;				///< 90 degrees out
-	double filteredPinkNoiseOut = 0.0;	
-	double gaussianNoiseOut;
-	double filteredgaussianNoiseOut;///< -90 degrees out
+	double pinkNoiseOut = 0.0;
+	double filteredPinkNoiseOut = 0.0;
+	double gaussianNoiseOut = 0.0;
+	double filteredgaussianNoiseOut = 0.0;///< -90 degrees out
+};
+
+/**
+\class PinkNoise
+\ingroup FX-Objects
+\brief
+Voss-McCartney pink noise: kNumRows white rows, row k is refreshed every 2^(k+1) samples, chosen
+by counting the trailing zeros of a running counter so exactly one row changes per sample. Rows are
+integers so the running sum never drifts. Output is in [-1, +1) with a -3dB/octave slope from
+about sampleRate/2^17 up to Nyquist.
+
+The running sum is a serial dependency so there is nothing to gain from SIMD here; the RNG is a
+xorshift32 rather than rand() and the whole thing costs a handful of integer ops per sample.
+Use renderBlock() where you can, it keeps the state in registers.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class PinkNoise
+{
+public:
+	PinkNoise(void) { reset(0x9E3779B9u); }	/* C-TOR */
+	~PinkNoise(void) {}	/* D-TOR */
+
+	/** reset rows and counter; seed must be non-zero (zero is remapped) */
+	void reset(uint32_t seed)
+	{
+		rngState = seed ? seed : 0x9E3779B9u;
+		counter = 0;
+		runningSum = 0;
+		for (uint32_t i = 0; i < kNumRows; i++)
+		{
+			rows[i] = nextRandom();
+			runningSum += rows[i];
+		}
+	}
+
+	/** one sample */
+	inline double renderSample()
+	{
+		counter = (counter + 1) & kCounterMask;
+		if (counter != 0)
+		{
+			uint32_t row = countTrailingZeros(counter);
+			int32_t newValue = nextRandom();
+			runningSum += newValue - rows[row];
+			rows[row] = newValue;
+		}
+		return (double)(runningSum + nextRandom()) * kOutputScale;
+	}
+
+	/** fill a block */
+	void renderBlock(double* output, uint32_t numSamples)
+	{
+		for (uint32_t i = 0; i < numSamples; i++)
+			output[i] = renderSample();
+	}
+
+private:
+	static const uint32_t kNumRows = 16;
+	static const uint32_t kCounterMask = (1u << kNumRows) - 1;
+	static constexpr double kOutputScale = 1.0 / ((kNumRows + 1) * 8388608.0); ///< rows are +/-2^23
+
+	/** xorshift32 -> signed 24 bit */
+	inline int32_t nextRandom()
+	{
+		rngState ^= rngState << 13;
+		rngState ^= rngState >> 17;
+		rngState ^= rngState << 5;
+		return (int32_t)(rngState >> 8) - 8388608;
+	}
+
+	static inline uint32_t countTrailingZeros(uint32_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward(&index, value);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctz(value);
+#endif
+	}
+
+	int32_t rows[kNumRows] = { 0 };
+	int32_t runningSum = 0;
+	uint32_t counter = 0;
+	uint32_t rngState = 0x9E3779B9u;
 };
 
 /**
@@ -49,6 +163,7 @@ struct NoiseGeneratorParameters
 		// --- copy from params (argument) INTO our variables
 		lpf_fc_Hz = params.lpf_fc_Hz;
 		outputAmplitude = params.outputAmplitude;
+		requiredOutputs = params.requiredOutputs;
 
 		// --- MUST be last
 		return *this;
@@ -57,6 +172,7 @@ struct NoiseGeneratorParameters
 	// --- individual parameters
 	double lpf_fc_Hz= 1000.0;
 	double outputAmplitude = 1.0;
+	uint32_t requiredOutputs = kAllNoiseOutputs; ///< OR of noiseGenOutput flags
 };
 
 
@@ -91,17 +207,27 @@ public:
 		// --- store the sample rate
 		sampleRate = (_sampleRate);
 
-		// --- setup the audio filter
-		AudioFilterParameters params = lowPassFilter.getParameters();
+		// --- setup the audio filters; white and gaussian each get their own state
+		AudioFilterParameters params = whiteLowPassFilter.getParameters();
 		params.algorithm = filterAlgorithm::kButterLPF2;
-		params.fc = 100.0;
-		lowPassFilter.setParameters(params);
+		params.fc = parameters.lpf_fc_Hz;
+		whiteLowPassFilter.setParameters(params);
+		gaussianLowPassFilter.setParameters(params);
+		pinkLowPassFilter.setParameters(params);
 
 		// --- reset
-		lowPassFilter.reset(_sampleRate);
-
-		// --- seed random number generator
-		srand(time(NULL));
+		whiteLowPassFilter.reset(_sampleRate);
+		gaussianLowPassFilter.reset(_sampleRate);
+		pinkLowPassFilter.reset(_sampleRate);
+
+		// --- seed the shared rand() once per process: reseeding on every reset re-ran the same
+		//     sequence in every instance reset within the same second; each instance then draws
+		//     its own seeds from it
+		static std::once_flag seedOnce;
+		std::call_once(seedOnce, []() { srand((unsigned int)time(NULL)); });
+		pinkNoise.reset((uint32_t)rand() * 2654435761u + 1u);
+		gaussianEngine.seed((uint32_t)rand() * 2654435761u + 1u);
+		normalDistribution.reset();
 
 		return true;
 	}
@@ -110,28 +236,45 @@ public:
 	virtual const NoiseGenData renderAudioOutput()
 	{
 		NoiseGenData generatorOutput;
-
-		// --- noise
-		generatorOutput.whiteNoiseOut = doWhiteNoise();
-		generatorOutput.filteredWhiteNoiseOut = lowPassFilter.processAudioSample(generatorOutput.whiteNoiseOut);
-		generatorOutput.gaussianNoiseOut = doGaussianWhiteNoise();
-		generatorOutput.filteredgaussianNoiseOut = lowPassFilter.processAudioSample(generatorOutput.gaussianNoiseOut);
-
-		// --- TODO: add pink and filtered pink noise
-
-		generatorOutput.whiteNoiseOut *= parameters.outputAmplitude;
-		generatorOutput.filteredWhiteNoiseOut *= parameters.outputAmplitude;
-		generatorOutput.gaussianNoiseOut *= parameters.outputAmplitude;
-		generatorOutput.filteredgaussianNoiseOut *= parameters.outputAmplitude;
+		const uint32_t outputs = parameters.requiredOutputs;
+
+		// --- white noise; only run the source if someone downstream uses it
+		if (outputs & (kWhiteNoiseOut | kFilteredWhiteNoiseOut))
+		{
+			double white = doWhiteNoise();
+			if (outputs & kWhiteNoiseOut)
+				generatorOutput.whiteNoiseOut = white * parameters.outputAmplitude;
+			if (outputs & kFilteredWhiteNoiseOut)
+				generatorOutput.filteredWhiteNoiseOut = whiteLowPassFilter.processAudioSample(white) * parameters.outputAmplitude;
+		}
+
+		// --- gaussian noise
+		if (outputs & (kGaussianNoiseOut | kFilteredGaussianNoiseOut))
+		{
+			double gaussian = doGaussianWhiteNoise();
+			if (outputs & kGaussianNoiseOut)
+				generatorOutput.gaussianNoiseOut = gaussian * parameters.outputAmplitude;
+			if (outputs & kFilteredGaussianNoiseOut)
+				generatorOutput.filteredgaussianNoiseOut = gaussianLowPassFilter.processAudioSample(gaussian) * parameters.outputAmplitude;
+		}
+
+		// --- pink noise
+		if (outputs & (kPinkNoiseOut | kFilteredPinkNoiseOut))
+		{
+			double pink = pinkNoise.renderSample();
+			if (outputs & kPinkNoiseOut)
+				generatorOutput.pinkNoiseOut = pink * parameters.outputAmplitude;
+			if (outputs & kFilteredPinkNoiseOut)
+				generatorOutput.filteredPinkNoiseOut = pinkLowPassFilter.processAudioSample(pink) * parameters.outputAmplitude;
+		}
 
 		return generatorOutput;
 	}
 
+	/** from the member engine, seeded in reset(): a fresh default engine per call returned the same value every sample */
 	inline double doGaussianWhiteNoise(double mean = 0.0, double variance = 1.0)
 	{
-		std::default_random_engine defaultGeneratorEngine;
-		std::normal_distribution<double> normalDistribution(mean, variance);
-		double output = normalDistribution(defaultGeneratorEngine);
+		double output = normalDistribution(gaussianEngine, std::normal_distribution<double>::param_type(mean, variance));
 
 		// --- can scale here to change sigma
 
@@ -153,11 +296,18 @@ public:
 	*/
 	void setParameters(const NoiseGeneratorParameters& _params)
 	{
+		// --- only re-cook the filters if fc actually changed
+		bool cookFilters = _params.lpf_fc_Hz != parameters.lpf_fc_Hz;
 		parameters = _params;
 
-		AudioFilterParameters params = lowPassFilter.getParameters();
-		params.fc = _params.lpf_fc_Hz;
-		lowPassFilter.setParameters(params);
+		if (cookFilters)
+		{
+			AudioFilterParameters params = whiteLowPassFilter.getParameters();
+			params.fc = _params.lpf_fc_Hz;
+			whiteLowPassFilter.setParameters(params);
+			gaussianLowPassFilter.setParameters(params);
+			pinkLowPassFilter.setParameters(params);
+		}
 	}
 
 private:
@@ -166,8 +316,17 @@ private:
 	// --- local variables used by this object
 	double sampleRate = 0.0;	///< sample rate
 
-	// --- smoothing filter
-	AudioFilter lowPassFilter;
+	// --- smoothing filters, one per filtered output so they never share state
+	AudioFilter whiteLowPassFilter;
+	AudioFilter gaussianLowPassFilter;
+	AudioFilter pinkLowPassFilter;
+
+	// --- pink source
+	PinkNoise pinkNoise;
+
+	// --- gaussian source; the distribution keeps the spare value of each generated pair
+	std::minstd_rand gaussianEngine;
+	std::normal_distribution<double> normalDistribution;
 
 };
 
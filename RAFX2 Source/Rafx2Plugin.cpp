@@ -1,5 +1,178 @@
 #include "Rafx2Plugin.h"
 #include "..\PluginKernel\plugingui.h"
+#include "..\PluginObjects\ScaledBitmapCache.h"
+#include "..\PluginObjects\UIDescriptionCache.h"
+#include "vstgui/uidescription/cstream.h"
+#include <map>
+#include <set>
+
+// --- Scale GUI support: at any Scale GUI size but normal, every editor bitmap gets a copy
+//     pre-rendered at that size added as an extra platform bitmap; VSTGUI draws with the one
+//     matching the frame's scale transform, so a scaled editor blits 1:1 instead of resampling
+//     on every paint. Only a selected size is rendered, once per process, on the editor cache's
+//     worker (see ScaledBitmapCache), and the platform bitmaps made from the renders are shared
+//     by every editor. Driven from the sync ping, so everything here runs on the UI thread.
+static const uint32_t kNormalGUIScale = 3; ///< "normal" in the Scale GUI list
+
+static bool readBitmapPixels(VSTGUI::CBitmap* bitmap, PixelImage& image)
+{
+	VSTGUI::SharedPointer<VSTGUI::CBitmapPixelAccess> access = VSTGUI::owned(VSTGUI::CBitmapPixelAccess::create(bitmap));
+	if (!access)
+		return false;
+	image.width = access->getBitmapWidth();
+	image.height = access->getBitmapHeight();
+	image.pixels.resize((size_t)image.width * image.height * 4);
+	for (uint32_t y = 0; y < image.height; y++)
+		memcpy(&image.pixels[(size_t)y * image.width * 4], access->getAddress() + (size_t)y * access->getBytesPerRow(), image.width * 4);
+	return true;
+}
+
+/** one bitmap of an open editor, and the sizes it has been given (or can't take) so far */
+struct ScaledEditorBitmap
+{
+	VSTGUI::CBitmap* bitmap;
+	ScaledBitmapKey key;
+	uint32_t doneScales;
+};
+
+/** an open editor's bitmaps, collected the first time it is at a size other than normal */
+struct ScaledEditor
+{
+	bool collected = false;
+	std::vector<ScaledEditorBitmap> bitmaps;
+	uint32_t doneScales = 0; ///< every bitmap has these sizes
+};
+
+static std::map<VSTGUI::PluginGUI*, ScaledEditor>& getScaledEditors()
+{
+	static std::map<VSTGUI::PluginGUI*, ScaledEditor> editors;
+	return editors;
+}
+
+/** platform bitmaps made from the renders, per bitmap and size; null where the render doesn't fit the bitmap */
+static std::map<std::pair<ScaledBitmapKey, uint32_t>, VSTGUI::SharedPointer<VSTGUI::IPlatformBitmap>>& getScaledPlatformBitmaps()
+{
+	static std::map<std::pair<ScaledBitmapKey, uint32_t>, VSTGUI::SharedPointer<VSTGUI::IPlatformBitmap>> platformBitmaps;
+	return platformBitmaps;
+}
+
+static VSTGUI::SharedPointer<VSTGUI::IPlatformBitmap> makePlatformBitmap(VSTGUI::CBitmap* bitmap, const PixelImage& image, double scale)
+{
+	// --- CBitmap::addBitmap() insists the copy scales back to exactly the bitmap's size
+	if (std::round(image.width / scale) != bitmap->getWidth() || std::round(image.height / scale) != bitmap->getHeight())
+		return nullptr;
+
+	VSTGUI::CPoint size(image.width, image.height);
+	VSTGUI::SharedPointer<VSTGUI::IPlatformBitmap> platformBitmap = VSTGUI::IPlatformBitmap::create(&size);
+	if (!platformBitmap)
+		return nullptr;
+	VSTGUI::SharedPointer<VSTGUI::IPlatformBitmapPixelAccess> pixels = platformBitmap->lockPixels(true);
+	if (!pixels)
+		return nullptr;
+	for (uint32_t y = 0; y < image.height; y++)
+		memcpy(pixels->getAddress() + (size_t)y * pixels->getBytesPerRow(), &image.pixels[(size_t)y * image.width * 4], image.width * 4);
+	pixels = nullptr; // --- unlock before handing it over
+	platformBitmap->setScaleFactor(scale);
+	return platformBitmap;
+}
+
+static void collectBitmaps(VSTGUI::CView* view, std::set<VSTGUI::CBitmap*>& visited, std::vector<ScaledEditorBitmap>& bitmaps)
+{
+	// --- knob filmstrips are scaled frame by frame
+	uint32_t frameHeight = 0;
+	if (VSTGUI::IMultiBitmapControl* multiBitmap = dynamic_cast<VSTGUI::IMultiBitmapControl*>(view))
+		frameHeight = (uint32_t)multiBitmap->getHeightOfOneImage();
+
+	VSTGUI::CBitmap* viewBitmaps[2] = { view->getBackground(), view->getDisabledBackground() };
+	for (VSTGUI::CBitmap* bitmap : viewBitmaps)
+	{
+		if (!bitmap || !visited.insert(bitmap).second)
+			continue;
+		const VSTGUI::CResourceDescription& resource = bitmap->getResourceDescription();
+		if (resource.type == VSTGUI::CResourceDescription::kStringType && resource.u.name)
+			bitmaps.push_back({ bitmap, { resource.u.name, frameHeight }, 0 });
+	}
+
+	if (VSTGUI::CViewContainer* container = dynamic_cast<VSTGUI::CViewContainer*>(view))
+		for (uint32_t i = 0; i < container->getNbViews(); i++)
+			collectBitmaps(container->getView(i), visited, bitmaps);
+}
+
+/** give an editor's bitmaps the selected size; what is still rendering is picked up on a later ping */
+static void syncScaledBitmaps(VSTGUI::PluginGUI* gui, PluginCore* core)
+{
+	const GUIParameterView& parameters = core->getGUIParameterView();
+	int32_t scaleParameter = parameters.findIndex(SCALE_GUI_SIZE);
+	uint32_t scaleIndex = scaleParameter >= 0 ? (uint32_t)parameters.getValue(scaleParameter) : kNormalGUIScale;
+	ScaledEditor& editor = getScaledEditors()[gui];
+	if (scaleIndex >= kNumGUIScales || scaleIndex == kNormalGUIScale || (editor.doneScales & (1u << scaleIndex)) || !gui->getFrame())
+		return;
+
+	if (!editor.collected)
+	{
+		std::set<VSTGUI::CBitmap*> visited;
+		collectBitmaps(gui->getFrame(), visited, editor.bitmaps);
+		editor.collected = true;
+	}
+
+	bool added = false;
+	bool complete = true;
+	for (ScaledEditorBitmap& entry : editor.bitmaps)
+	{
+		if (entry.doneScales & (1u << scaleIndex))
+			continue;
+		auto platformBitmap = getScaledPlatformBitmaps().find(std::make_pair(entry.key, scaleIndex));
+		if (platformBitmap == getScaledPlatformBitmaps().end())
+		{
+			ScaledBitmapCache::ImagePtr image = ScaledBitmapCache::find(entry.key, scaleIndex);
+			if (!image)
+			{
+				VSTGUI::CBitmap* bitmap = entry.bitmap;
+				if (ScaledBitmapCache::request(entry.key, scaleIndex, [bitmap](PixelImage& pixels) { return readBitmapPixels(bitmap, pixels); }, UIDescriptionCache::post))
+				{
+					complete = false;
+					continue;
+				}
+				entry.doneScales |= 1u << scaleIndex; // --- unreadable: stays with VSTGUI's scaling
+				continue;
+			}
+			platformBitmap = getScaledPlatformBitmaps().insert(std::make_pair(std::make_pair(entry.key, scaleIndex),
+				makePlatformBitmap(entry.bitmap, *image, kGUIScaleFactors[scaleIndex]))).first;
+		}
+		if (platformBitmap->second)
+		{
+			entry.bitmap->addBitmap(platformBitmap->second);
+			added = true;
+		}
+		entry.doneScales |= 1u << scaleIndex;
+	}
+	if (complete)
+		editor.doneScales |= 1u << scaleIndex;
+	if (added)
+		gui->getFrame()->invalid();
+}
+
+// --- the editor description: a loose PluginGUI.uidesc beside the binary (development builds),
+//     else the copy embedded in it (PluginGUIMain.rc and friends); runs on the cache's worker
+static bool readUIDescription(const std::string& looseFile, std::string& source)
+{
+	if (!looseFile.empty() && UIDescriptionCache::readFile(looseFile, source))
+		return true;
+
+	VSTGUI::CResourceInputStream stream;
+	if (!stream.open(VSTGUI::CResourceDescription("PluginGUI.uidesc")))
+		return false;
+	source.clear();
+	char buffer[65536];
+	for (;;)
+	{
+		uint32_t bytesRead = stream.readRaw(buffer, sizeof(buffer));
+		if (bytesRead == 0 || bytesRead == VSTGUI::kStreamIOError)
+			break;
+		source.append(buffer, bytesRead);
+	}
+	return !source.empty();
+}
 
 // --- CTOR
 Rafx2Plugin::Rafx2Plugin()
@@ -32,7 +205,12 @@ Rafx2Plugin::~Rafx2Plugin()
 bool Rafx2Plugin::initialize(PluginInfo& _pluginInfo)
 {
 	if (!pluginCore) return false;
-	return pluginCore->initialize(_pluginInfo);
+	bool initialized = pluginCore->initialize(_pluginInfo);
+
+	// --- split the editor description off the message thread, ready for the first open
+	std::string looseFile = pluginCore->pluginDirectory.empty() ? std::string() : pluginCore->pluginDirectory + "PluginGUI.uidesc";
+	UIDescriptionCache::start([looseFile](std::string& source) { return readUIDescription(looseFile, source); });
+	return initialized;
 }
 
 bool Rafx2Plugin::prepareForPlay(ResetInfo& info)
@@ -155,22 +333,16 @@ bool Rafx2Plugin::processRafx2Message(const Rafx2MessageInfo& messageInfo)
 			CreateGUIInfo* guiInfo = (CreateGUIInfo*)messageInfo.inMessageData;
 			guiPluginConnector->setParentConnector(guiInfo->guiPluginConnector);
 
-			std::vector<PluginParameter*>* PluginParameterPtr = pluginCore->makePluginParameterVectorCopy();
-
-			// --- create GUI
-			VSTGUI::UTF8StringPtr _xmlFile = "PluginGUI.uidesc";
+			// --- create GUI: from the pre-split layout (bitmaps as separate, lazily loaded files)
+			//     once the cache's worker has it, else the full exported description
+			std::string layoutFile = UIDescriptionCache::getLayoutFile();
+			VSTGUI::UTF8StringPtr _xmlFile = layoutFile.empty() ? "PluginGUI.uidesc" : layoutFile.c_str();
 			pluginGUI = new VSTGUI::PluginGUI(_xmlFile);
 			if (!pluginGUI) return false;
 
-			bool opened = ((VSTGUI::PluginGUI*)pluginGUI)->open("Editor", guiInfo->window, PluginParameterPtr, VSTGUI::kHWND, guiPluginConnector, nullptr);
-
-			// --- delete the PluginParameterPtr guts, and pointer too...
-			for (std::vector<PluginParameter*>::iterator it = PluginParameterPtr->begin(); it != PluginParameterPtr->end(); ++it)
-			{
-				delete *it;
-			}
-
-			delete PluginParameterPtr;
+			// --- the GUI builds its controls from the core's live parameters, read through the view;
+			//     no throwaway deep copy of every parameter per open
+			bool opened = ((VSTGUI::PluginGUI*)pluginGUI)->open("Editor", guiInfo->window, pluginCore->getGUIParameterView().getParameterList(), VSTGUI::kHWND, guiPluginConnector, nullptr);
 
 			if (opened)
 			{
@@ -181,6 +353,12 @@ bool Rafx2Plugin::processRafx2Message(const Rafx2MessageInfo& messageInfo)
 				guiInfo->height = height;
 
 				((VSTGUI::PluginGUI*)pluginGUI)->setGUIWindowFrame(guiInfo->guiWindowFrame);
+
+				// --- opened at a size other than normal: start on (or add) that size's bitmaps
+				syncScaledBitmaps((VSTGUI::PluginGUI*)pluginGUI, pluginCore);
+
+				// --- the editor was just built from the current values
+				pluginCore->guiChangeTracker.markAllSynced();
 			}
 			return true;
 		}
@@ -198,13 +376,14 @@ bool Rafx2Plugin::processRafx2Message(const Rafx2MessageInfo& messageInfo)
 
 				// --- self-destruct
 				VSTGUI::PluginGUI* oldGUI = ((VSTGUI::PluginGUI*)pluginGUI);
+				getScaledEditors().erase(oldGUI);
 				pluginGUI = 0;
 				oldGUI->forget();
 			}
 			return true;
 		}
 
-		// --- resync the GUI to the current parameter values
+		// --- resync the GUI: only the controls whose value changed since the last ping
 		case PLUGINGUI_USER_CUSTOMSYNC:
 		{
 			resyncGUI();
@@ -257,28 +436,41 @@ bool Rafx2Plugin::updatePluginParameterNormalized(uint32_t controlID, double nor
 }
 
 // --- these can be called at any time; not used in RAFX2 implementation
+//     each one flags the control through storeControlValue() so its bound variable syncs next buffer
 void Rafx2Plugin::setParameterNormalizedByIndex(uint32_t index, double normalizedValue)
 {
 	if (!pluginCore) return;
-	pluginCore->getPluginParameterByIndex(index)->setControlValueNormalized(normalizedValue);
+	PluginParameter* piParam = pluginCore->getPluginParameterByIndex(index);
+	if (!piParam) return;
+	piParam->setControlValueNormalized(normalizedValue);
+	pluginCore->storeControlValue(piParam->getControlID(), piParam);
 }
 
 void Rafx2Plugin::setParameterByIndex(uint32_t index, double actualValue)
 {
 	if (!pluginCore) return;
-	pluginCore->getPluginParameterByIndex(index)->setControlValue(actualValue);
+	PluginParameter* piParam = pluginCore->getPluginParameterByIndex(index);
+	if (!piParam) return;
+	piParam->setControlValue(actualValue);
+	pluginCore->storeControlValue(piParam->getControlID(), piParam);
 }
 
 void Rafx2Plugin::setParameterNormalizedByControlID(uint32_t controlID, double normalizedValue)
 {
 	if (!pluginCore) return;
-	pluginCore->getPluginParameterByControlID(controlID)->setControlValueNormalized(normalizedValue);
+	PluginParameter* piParam = pluginCore->getControlParameter(controlID);
+	if (!piParam) return;
+	piParam->setControlValueNormalized(normalizedValue);
+	pluginCore->storeControlValue(controlID, piParam);
 }
 
 void Rafx2Plugin::setParameterByControlID(uint32_t controlID, double actualValue)
 {
 	if (!pluginCore) return;
-	pluginCore->getPluginParameterByControlID(controlID)->setControlValue(actualValue);
+	PluginParameter* piParam = pluginCore->getControlParameter(controlID);
+	if (!piParam) return;
+	piParam->setControlValue(actualValue);
+	pluginCore->storeControlValue(controlID, piParam);
 }
 
 double Rafx2Plugin::getParameterNormalizedByIndex(uint32_t index)
@@ -296,13 +488,13 @@ double Rafx2Plugin::getParameterByIndex(uint32_t index)
 double Rafx2Plugin::getParameterNormalizedByControlID(uint32_t controlID)
 {
 	if (!pluginCore) return 0.0;
-	return pluginCore->getPluginParameterByControlID(controlID)->getControlValueNormalized();
+	return pluginCore->getControlParameter(controlID)->getControlValueNormalized();
 }
 
 double Rafx2Plugin::getParameterByControlID(uint32_t controlID)
 {
 	if (!pluginCore) return 0.0;
-	return pluginCore->getPluginParameterByControlID(controlID)->getControlValue();
+	return pluginCore->getControlParameter(controlID)->getControlValue();
 }
 
 AuxParameterAttribute* Rafx2Plugin::getAuxParameterAttributeByIndex(uint32_t index, uint32_t attributeID)
@@ -314,7 +506,7 @@ AuxParameterAttribute* Rafx2Plugin::getAuxParameterAttributeByIndex(uint32_t ind
 AuxParameterAttribute* Rafx2Plugin::getAuxParameterAttributeByControlID(uint32_t controlID, uint32_t attributeID)
 {
 	if (!pluginCore) return nullptr;
-	return pluginCore->getPluginParameterByControlID(controlID)->getAuxAttribute(attributeID);
+	return pluginCore->getControlParameter(controlID)->getAuxAttribute(attributeID);
 }
 
 uint32_t Rafx2Plugin::getDefaultChannelIOConfigForChannelCount(uint32_t channelCount)
@@ -339,7 +531,7 @@ bool Rafx2Plugin::hasParameterWithIndex(uint32_t index)
 bool Rafx2Plugin::hasParameterWithControlID(uint32_t controlID)
 {
 	if (!pluginCore) return false;
-	if (pluginCore->getPluginParameterByControlID(controlID)) return true;
+	if (pluginCore->getControlParameter(controlID)) return true;
 	else return false;
 }
 
@@ -364,20 +556,24 @@ void Rafx2Plugin::resyncGUIControl(uint32_t controlID)
 	((VSTGUI::PluginGUI*)pluginGUI)->syncGUIControl(controlID);
 }
 
+// --- the controls whose value changed since the last call (see ControlChangeTracker); every
+//     control after a change to one without a dense slot
 void Rafx2Plugin::resyncGUI()
 {
-	if (!pluginGUI) return;
+	if (!pluginGUI || !pluginCore) return;
 
-	for (unsigned int i = 0; i < pluginCore->getPluginParameterCount(); i++)
+	syncScaledBitmaps((VSTGUI::PluginGUI*)pluginGUI, pluginCore);
+
+	if (pluginCore->guiChangeTracker.takeFullSync())
 	{
-		PluginParameter* piParam = pluginCore->getPluginParameterByIndex(i);
-		if (piParam)
-		{
-			((VSTGUI::PluginGUI*)pluginGUI)->syncGUIControl(piParam->getControlID());
-		}
+		const GUIParameterView& parameters = pluginCore->getGUIParameterView();
+		for (uint32_t i = 0; i < parameters.size(); i++)
+			resyncGUIControl(parameters.getDescriptor(i).controlID);
+		pluginCore->guiChangeTracker.markAllSynced();
+		return;
 	}
 
-	return;
+	pluginCore->guiChangeTracker.syncChanged([this](uint32_t slot) { resyncGUIControl(kDenseControlIDs[slot]); });
 }
 
 void Rafx2Plugin::setupTrackPad()
@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef __OfflineProcessor__
+#define __OfflineProcessor__
+
+#include "PluginCore.h"
+
+#include <cstdint>
+#include <vector>
+
+/** the kernel fires MIDI every frame; offline there is none */
+class NoMidiEventQueue : public IMidiEventQueue
+{
+public:
+	virtual uint32_t getEventCount() override { return 0; }
+	virtual bool fireMidiEvents(uint32_t sampleOffset) override { return true; }
+};
+
+/**
+\class OfflineProcessor
+\ingroup Tools
+\brief
+Minimal stand-in for a plugin shell, for the headless tools: owns stereo input/output blocks
+and the ProcessBufferInfo that points at them, and drives PluginCore::processAudioBuffers()
+the way a host does - one call per block, host time advancing with the frames processed.
+
+Fill getInputs() with up to maxBlockSize frames, call process(frames), read getOutputs().
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class OfflineProcessor
+{
+public:
+	OfflineProcessor(PluginCore& _core, uint32_t _maxBlockSize)	/* C-TOR */
+		: core(_core)
+		, maxBlockSize(_maxBlockSize)
+		, inputStorage(2 * (size_t)_maxBlockSize, 0.f)
+		, outputStorage(2 * (size_t)_maxBlockSize, 0.f)
+	{
+		inputs[0] = &inputStorage[0];
+		inputs[1] = &inputStorage[maxBlockSize];
+		outputs[0] = &outputStorage[0];
+		outputs[1] = &outputStorage[maxBlockSize];
+
+		processBufferInfo.inputs = inputs;
+		processBufferInfo.outputs = outputs;
+		processBufferInfo.numAudioInChannels = 2;
+		processBufferInfo.numAudioOutChannels = 2;
+		processBufferInfo.channelIOConfig = ChannelIOConfig(kCFStereo, kCFStereo);
+		processBufferInfo.auxChannelIOConfig = ChannelIOConfig(kCFNone, kCFNone);
+		processBufferInfo.hostInfo = &hostInfo;
+		processBufferInfo.midiEventQueue = &midiEventQueue;
+	}
+
+	/** PluginCore::reset() at a new rate; host time starts over */
+	bool reset(double _sampleRate, uint32_t bitDepth = 32)
+	{
+		sampleRate = _sampleRate;
+		framesProcessed = 0;
+		ResetInfo resetInfo;
+		resetInfo.sampleRate = sampleRate;
+		resetInfo.bitDepth = bitDepth;
+		return core.reset(resetInfo);
+	}
+
+	/** process the first frames (<= maxBlockSize) of the input blocks */
+	bool process(uint32_t frames)
+	{
+		processBufferInfo.numFramesToProcess = frames < maxBlockSize ? frames : maxBlockSize;
+		hostInfo.uAbsoluteFrameBufferIndex = framesProcessed;
+		hostInfo.dAbsoluteFrameBufferTime = (double)framesProcessed / sampleRate;
+		framesProcessed += processBufferInfo.numFramesToProcess;
+		return core.processAudioBuffers(processBufferInfo);
+	}
+
+	float** getInputs() { return inputs; }
+	float** getOutputs() { return outputs; }
+	uint32_t getMaxBlockSize() const { return maxBlockSize; }
+	uint64_t getFramesProcessed() const { return framesProcessed; }
+
+private:
+	PluginCore& core;
+	uint32_t maxBlockSize = 0;
+	double sampleRate = 44100.0;
+	uint64_t framesProcessed = 0;
+
+	std::vector<float> inputStorage;
+	std::vector<float> outputStorage;
+	float* inputs[2] = { nullptr, nullptr };
+	float* outputs[2] = { nullptr, nullptr };
+
+	NoMidiEventQueue midiEventQueue;
+	HostInfo hostInfo;
+	ProcessBufferInfo processBufferInfo;
+};
+
+#endif
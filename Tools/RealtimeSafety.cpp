@@ -0,0 +1,311 @@
+// -----------------------------------------------------------------------------
+//    Echoplex real-time safety checker:  RealtimeSafety.cpp
+//
+/**
+    \file   RealtimeSafety.cpp
+    \brief  interposers behind RealtimeSafety / RealtimeScope; see RealtimeSafety.h
+
+    Functions defined in the executable win the dynamic symbol lookup, so libstdc++ and
+    every other library call these; each one checks the calling thread's scope depth and
+    forwards to glibc (the __libc_* allocator entry points, or the next definition found
+    with dlsym(RTLD_NEXT)). Nothing here allocates or locks, so the checks can't recurse.
+*/
+// -----------------------------------------------------------------------------
+#include "RealtimeSafety.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#define ECHOPLEX_RT_INTERPOSE 1
+#endif
+
+#if ECHOPLEX_RT_INTERPOSE
+// --- the fortified inline open()/read() wrappers would clash with the definitions below
+#undef _FORTIFY_SOURCE
+#include <cerrno>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// --- per thread, plain __thread in the static TLS block: no lazy init, no allocation on first use
+static __thread int scopeDepth __attribute__((tls_model("initial-exec"))) = 0;
+static __thread const char* scopeContext __attribute__((tls_model("initial-exec"))) = nullptr;
+static __thread bool reporting __attribute__((tls_model("initial-exec"))) = false;
+
+static std::atomic<uint64_t> violationCount{ 0 };
+static std::atomic<bool> abortOnViolation{ true };
+
+/** the first backtrace() loads libgcc's unwinder (which allocates): do it before any scope opens */
+__attribute__((constructor)) static void primeBacktrace()
+{
+	void* frame[1];
+	backtrace(frame, 1);
+}
+
+static void reportViolation(const char* call)
+{
+	reporting = true;
+	violationCount.fetch_add(1, std::memory_order_relaxed);
+
+	char message[256];
+	int length = snprintf(message, sizeof(message), "\nrealtime violation: %s inside RealtimeScope(\"%s\")\n", call, scopeContext ? scopeContext : "");
+	if (length > 0)
+	{
+		ssize_t written = ::write(STDERR_FILENO, message, (size_t)length < sizeof(message) ? (size_t)length : sizeof(message) - 1);
+		(void)written; // --- nowhere better to report a failed report
+	}
+	void* frames[64];
+	int numFrames = backtrace(frames, 64);
+	backtrace_symbols_fd(frames, numFrames, STDERR_FILENO);
+
+	if (abortOnViolation.load(std::memory_order_relaxed))
+		abort();
+	reporting = false;
+}
+
+static inline void checkRealtime(const char* call)
+{
+	if (scopeDepth > 0 && !reporting)
+		reportViolation(call);
+}
+
+/** the definition this one shadows, looked up on first use (dlsym only allocates on failure) */
+#define NEXT_DEFINITION(name) \
+	static decltype(&name) nextDefinition = nullptr; \
+	if (!nextDefinition) \
+		nextDefinition = (decltype(&name))dlsym(RTLD_NEXT, #name)
+
+extern "C"
+{
+	// --- glibc's own allocator entry points
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* pointer, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void* pointer);
+
+	// --- memory
+	void* malloc(size_t size)
+	{
+		checkRealtime("malloc");
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t count, size_t size)
+	{
+		checkRealtime("calloc");
+		return __libc_calloc(count, size);
+	}
+
+	void* realloc(void* pointer, size_t size)
+	{
+		checkRealtime("realloc");
+		return __libc_realloc(pointer, size);
+	}
+
+	void free(void* pointer)
+	{
+		if (pointer)
+			checkRealtime("free");
+		__libc_free(pointer);
+	}
+
+	void* memalign(size_t alignment, size_t size)
+	{
+		checkRealtime("memalign");
+		return __libc_memalign(alignment, size);
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size)
+	{
+		checkRealtime("aligned_alloc");
+		return __libc_memalign(alignment, size);
+	}
+
+	int posix_memalign(void** pointer, size_t alignment, size_t size)
+	{
+		checkRealtime("posix_memalign");
+		if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+			return EINVAL;
+		void* memory = __libc_memalign(alignment, size);
+		if (!memory)
+			return ENOMEM;
+		*pointer = memory;
+		return 0;
+	}
+
+	// --- locks and waits
+	int pthread_mutex_lock(pthread_mutex_t* mutex)
+	{
+		checkRealtime("pthread_mutex_lock");
+		NEXT_DEFINITION(pthread_mutex_lock);
+		return nextDefinition(mutex);
+	}
+
+	int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock)
+	{
+		checkRealtime("pthread_rwlock_rdlock");
+		NEXT_DEFINITION(pthread_rwlock_rdlock);
+		return nextDefinition(rwlock);
+	}
+
+	int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock)
+	{
+		checkRealtime("pthread_rwlock_wrlock");
+		NEXT_DEFINITION(pthread_rwlock_wrlock);
+		return nextDefinition(rwlock);
+	}
+
+	int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex)
+	{
+		checkRealtime("pthread_cond_wait");
+		NEXT_DEFINITION(pthread_cond_wait);
+		return nextDefinition(condition, mutex);
+	}
+
+	int pthread_cond_timedwait(pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* time)
+	{
+		checkRealtime("pthread_cond_timedwait");
+		NEXT_DEFINITION(pthread_cond_timedwait);
+		return nextDefinition(condition, mutex, time);
+	}
+
+	int sem_wait(sem_t* semaphore)
+	{
+		checkRealtime("sem_wait");
+		NEXT_DEFINITION(sem_wait);
+		return nextDefinition(semaphore);
+	}
+
+	int nanosleep(const struct timespec* request, struct timespec* remaining)
+	{
+		checkRealtime("nanosleep");
+		NEXT_DEFINITION(nanosleep);
+		return nextDefinition(request, remaining);
+	}
+
+	int usleep(useconds_t microseconds)
+	{
+		checkRealtime("usleep");
+		NEXT_DEFINITION(usleep);
+		return nextDefinition(microseconds);
+	}
+
+	int sched_yield()
+	{
+		checkRealtime("sched_yield");
+		NEXT_DEFINITION(sched_yield);
+		return nextDefinition();
+	}
+
+	// --- files and mappings
+	int open(const char* path, int flags, ...)
+	{
+		checkRealtime("open");
+		mode_t mode = 0;
+		if (flags & (O_CREAT | O_TMPFILE))
+		{
+			va_list arguments;
+			va_start(arguments, flags);
+			mode = (mode_t)va_arg(arguments, int);
+			va_end(arguments);
+		}
+		NEXT_DEFINITION(open);
+		return nextDefinition(path, flags, mode);
+	}
+
+	int open64(const char* path, int flags, ...)
+	{
+		checkRealtime("open64");
+		mode_t mode = 0;
+		if (flags & (O_CREAT | O_TMPFILE))
+		{
+			va_list arguments;
+			va_start(arguments, flags);
+			mode = (mode_t)va_arg(arguments, int);
+			va_end(arguments);
+		}
+		NEXT_DEFINITION(open64);
+		return nextDefinition(path, flags, mode);
+	}
+
+	FILE* fopen(const char* path, const char* mode)
+	{
+		checkRealtime("fopen");
+		NEXT_DEFINITION(fopen);
+		return nextDefinition(path, mode);
+	}
+
+	ssize_t read(int fd, void* buffer, size_t count)
+	{
+		checkRealtime("read");
+		NEXT_DEFINITION(read);
+		return nextDefinition(fd, buffer, count);
+	}
+
+	ssize_t write(int fd, const void* buffer, size_t count)
+	{
+		checkRealtime("write");
+		NEXT_DEFINITION(write);
+		return nextDefinition(fd, buffer, count);
+	}
+
+	int close(int fd)
+	{
+		checkRealtime("close");
+		NEXT_DEFINITION(close);
+		return nextDefinition(fd);
+	}
+
+	void* mmap(void* address, size_t length, int protection, int flags, int fd, off_t offset)
+	{
+		checkRealtime("mmap");
+		NEXT_DEFINITION(mmap);
+		return nextDefinition(address, length, protection, flags, fd, offset);
+	}
+
+	int munmap(void* address, size_t length)
+	{
+		checkRealtime("munmap");
+		NEXT_DEFINITION(munmap);
+		return nextDefinition(address, length);
+	}
+}
+
+bool RealtimeSafety::isSupported() { return true; }
+
+void RealtimeSafety::setAbortOnViolation(bool _abortOnViolation) { abortOnViolation.store(_abortOnViolation); }
+
+uint64_t RealtimeSafety::getViolationCount() { return violationCount.load(); }
+
+void RealtimeSafety::enterRealtimeScope(const char* context)
+{
+	if (scopeDepth++ == 0)
+		scopeContext = context;
+}
+
+void RealtimeSafety::leaveRealtimeScope()
+{
+	if (scopeDepth > 0 && --scopeDepth == 0)
+		scopeContext = nullptr;
+}
+
+#else
+
+bool RealtimeSafety::isSupported() { return false; }
+void RealtimeSafety::setAbortOnViolation(bool) {}
+uint64_t RealtimeSafety::getViolationCount() { return 0; }
+void RealtimeSafety::enterRealtimeScope(const char*) {}
+void RealtimeSafety::leaveRealtimeScope() {}
+
+#endif
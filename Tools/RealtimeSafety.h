@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef __RealtimeSafety__
+#define __RealtimeSafety__
+
+#include <cstdint>
+
+/**
+\class RealtimeSafety
+\ingroup Tools
+\brief
+Audio-thread rule checker for the headless tools. Linking RealtimeSafety.cpp into an
+executable interposes malloc/calloc/realloc/free (and so operator new/delete), the aligned
+allocators, pthread mutex/rwlock/condition waits, sem_wait, sleeps, sched_yield and the
+file/mapping syscalls open/read/write/close/mmap/munmap. While a thread is inside a
+RealtimeScope, any of those calls is a violation: it is reported on stderr with the scope's
+context and a stack trace, then the process aborts (or, with setAbortOnViolation(false), the
+violation is counted and the call goes ahead).
+
+Other threads, and the checking thread outside a scope, are never affected. Uncontended
+locks taken inside libc itself (rand(), stdio) don't go through the interposed functions and
+are not caught.
+
+glibc only; elsewhere isSupported() returns false and scopes check nothing.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class RealtimeSafety
+{
+public:
+	static bool isSupported();
+
+	/** default true: the first violation aborts with its stack trace */
+	static void setAbortOnViolation(bool abortOnViolation);
+	static uint64_t getViolationCount();
+
+	/** nesting is fine; context should be a string literal (it is not copied) */
+	static void enterRealtimeScope(const char* context);
+	static void leaveRealtimeScope();
+};
+
+/** everything this thread does while one of these is alive must be real-time safe */
+class RealtimeScope
+{
+public:
+	explicit RealtimeScope(const char* context) { RealtimeSafety::enterRealtimeScope(context); }	/* C-TOR */
+	~RealtimeScope() { RealtimeSafety::leaveRealtimeScope(); }	/* D-TOR */
+
+	RealtimeScope(const RealtimeScope&) = delete;
+	RealtimeScope& operator=(const RealtimeScope&) = delete;
+};
+
+#endif
@@ -0,0 +1,284 @@
+#pragma once
+
+#ifndef __WavFile__
+#define __WavFile__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/** WAVE_FORMAT_* tags we read and write */
+const uint16_t kWavFormatPCM = 1;
+const uint16_t kWavFormatFloat = 3;
+const uint16_t kWavFormatExtensible = 0xFFFE;
+
+/**
+\class WavReader
+\ingroup Tools
+\brief
+Streaming reader for PCM (16, 24, 32 bit) and 32 bit float WAV files, including
+WAVE_FORMAT_EXTENSIBLE; deinterleaves straight into per-channel float buffers, so a file of any
+length is read in fixed size blocks without loading it.
+
+Assumes a little endian host, like the rest of the project.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class WavReader
+{
+public:
+	~WavReader() { close(); }	/* D-TOR */
+
+	/** \return false, with getError() set, if the file can't be read or isn't a format we handle */
+	bool open(const char* path)
+	{
+		close();
+		file = fopen(path, "rb");
+		if (!file)
+			return fail("can't open file");
+
+		char riff[12];
+		if (fread(riff, 1, 12, file) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+			return fail("not a RIFF/WAVE file");
+
+		bool haveFormat = false;
+		uint32_t dataSize = 0;
+		for (;;)
+		{
+			char chunkID[4];
+			uint32_t chunkSize = 0;
+			if (fread(chunkID, 1, 4, file) != 4 || fread(&chunkSize, 4, 1, file) != 1)
+				return fail(haveFormat ? "no data chunk" : "no fmt chunk");
+
+			if (memcmp(chunkID, "fmt ", 4) == 0)
+			{
+				uint8_t format[40] = { 0 };
+				uint32_t formatSize = chunkSize < sizeof(format) ? chunkSize : (uint32_t)sizeof(format);
+				if (chunkSize < 16 || fread(format, 1, formatSize, file) != formatSize)
+					return fail("bad fmt chunk");
+				memcpy(&formatTag, format, 2);
+				memcpy(&numChannels, format + 2, 2);
+				memcpy(&sampleRate, format + 4, 4);
+				memcpy(&bitsPerSample, format + 14, 2);
+				if (formatTag == kWavFormatExtensible && chunkSize >= 26)
+					memcpy(&formatTag, format + 24, 2); // --- first two bytes of the SubFormat GUID
+				if (fseek(file, (long)(chunkSize - formatSize + (chunkSize & 1)), SEEK_CUR) != 0)
+					return fail("bad fmt chunk");
+				haveFormat = true;
+			}
+			else if (memcmp(chunkID, "data", 4) == 0)
+			{
+				if (!haveFormat)
+					return fail("data before fmt chunk");
+				dataSize = chunkSize;
+				break;
+			}
+			else if (fseek(file, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR) != 0)
+				return fail("truncated file");
+		}
+
+		bool pcm = formatTag == kWavFormatPCM && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+		bool ieee = formatTag == kWavFormatFloat && bitsPerSample == 32;
+		if (!pcm && !ieee)
+			return fail("unsupported sample format (PCM 16/24/32 or 32 bit float only)");
+		if (numChannels == 0 || sampleRate == 0)
+			return fail("bad fmt chunk");
+
+		bytesPerFrame = numChannels * (bitsPerSample / 8);
+		framesRemaining = dataSize / bytesPerFrame;
+		numFrames = framesRemaining;
+		return true;
+	}
+
+	void close()
+	{
+		if (file)
+			fclose(file);
+		file = nullptr;
+	}
+
+	/**
+	read up to maxFrames frames into channels[0 .. getChannelCount()-1]
+
+	\return frames read; 0 at the end of the data
+	*/
+	uint32_t read(float** channels, uint32_t maxFrames)
+	{
+		uint32_t frames = maxFrames < framesRemaining ? maxFrames : (uint32_t)framesRemaining;
+		if (!file || frames == 0)
+			return 0;
+		interleaved.resize((size_t)frames * bytesPerFrame);
+		frames = (uint32_t)(fread(&interleaved[0], bytesPerFrame, frames, file));
+		framesRemaining -= frames;
+
+		uint32_t bytesPerSample = bitsPerSample / 8;
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			const uint8_t* p = &interleaved[(size_t)frame * bytesPerFrame];
+			for (uint32_t channel = 0; channel < numChannels; channel++, p += bytesPerSample)
+				channels[channel][frame] = decodeSample(p);
+		}
+		return frames;
+	}
+
+	uint32_t getChannelCount() const { return numChannels; }
+	uint32_t getSampleRate() const { return sampleRate; }
+	uint32_t getBitDepth() const { return bitsPerSample; }
+	uint64_t getFrameCount() const { return numFrames; }
+	const std::string& getError() const { return error; }
+
+private:
+	float decodeSample(const uint8_t* p) const
+	{
+		if (formatTag == kWavFormatFloat)
+		{
+			float value;
+			memcpy(&value, p, 4);
+			return value;
+		}
+		if (bitsPerSample == 16)
+		{
+			int16_t value;
+			memcpy(&value, p, 2);
+			return value * (1.f / 32768.f);
+		}
+		if (bitsPerSample == 24)
+		{
+			int32_t value = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+			return value * (1.f / 8388608.f);
+		}
+		int32_t value;
+		memcpy(&value, p, 4);
+		return (float)(value * (1.0 / 2147483648.0));
+	}
+
+	bool fail(const char* message)
+	{
+		error = message;
+		close();
+		return false;
+	}
+
+	FILE* file = nullptr;
+	std::string error;
+	std::vector<uint8_t> interleaved;
+	uint16_t formatTag = 0;
+	uint16_t numChannels = 0;
+	uint32_t sampleRate = 0;
+	uint16_t bitsPerSample = 0;
+	uint32_t bytesPerFrame = 0;
+	uint64_t numFrames = 0;
+	uint64_t framesRemaining = 0;
+};
+
+/**
+\class WavWriter
+\ingroup Tools
+\brief
+Streaming WAV writer: 16 or 24 bit PCM (clipped, rounded) or 32 bit float. The header is
+written with zero sizes on open() and patched in close(), so output can be any length.
+
+\version Revision : 1.0
+\date Date : 2019 / 01 / 31
+*/
+class WavWriter
+{
+public:
+	~WavWriter() { close(); }	/* D-TOR */
+
+	/** bitDepth 16 or 24 writes PCM, 32 writes float */
+	bool open(const char* path, uint32_t _numChannels, uint32_t sampleRate, uint32_t _bitDepth)
+	{
+		close();
+		if (_bitDepth != 16 && _bitDepth != 24 && _bitDepth != 32)
+			return false;
+		numChannels = _numChannels;
+		bitDepth = _bitDepth;
+		file = fopen(path, "wb");
+		if (!file)
+			return false;
+
+		uint16_t formatTag = bitDepth == 32 ? kWavFormatFloat : kWavFormatPCM;
+		uint16_t channels16 = (uint16_t)numChannels;
+		uint16_t blockAlign = (uint16_t)(numChannels * bitDepth / 8);
+		uint32_t byteRate = sampleRate * blockAlign;
+		uint16_t bits16 = (uint16_t)bitDepth;
+		uint32_t zero = 0;
+		uint32_t formatSize = 16;
+
+		bool ok = fwrite("RIFF", 1, 4, file) == 4 && fwrite(&zero, 4, 1, file) == 1 && fwrite("WAVEfmt ", 1, 8, file) == 8;
+		ok = ok && fwrite(&formatSize, 4, 1, file) == 1 && fwrite(&formatTag, 2, 1, file) == 1 && fwrite(&channels16, 2, 1, file) == 1;
+		ok = ok && fwrite(&sampleRate, 4, 1, file) == 1 && fwrite(&byteRate, 4, 1, file) == 1;
+		ok = ok && fwrite(&blockAlign, 2, 1, file) == 1 && fwrite(&bits16, 2, 1, file) == 1;
+		ok = ok && fwrite("data", 1, 4, file) == 4 && fwrite(&zero, 4, 1, file) == 1;
+		if (!ok)
+			close();
+		return ok;
+	}
+
+	/** interleave and append frames from channels[0 .. numChannels-1] */
+	bool write(float** channels, uint32_t frames)
+	{
+		if (!file)
+			return false;
+		uint32_t bytesPerSample = bitDepth / 8;
+		interleaved.resize((size_t)frames * numChannels * bytesPerSample);
+		uint8_t* p = interleaved.empty() ? nullptr : &interleaved[0];
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			for (uint32_t channel = 0; channel < numChannels; channel++, p += bytesPerSample)
+				encodeSample(channels[channel][frame], p);
+		}
+		if (fwrite(interleaved.data(), 1, interleaved.size(), file) != interleaved.size())
+			return false;
+		dataBytes += interleaved.size();
+		return true;
+	}
+
+	/** patch the RIFF and data sizes; \return false if the file couldn't be completed */
+	bool close()
+	{
+		if (!file)
+			return true;
+		bool ok = true;
+		if (dataBytes & 1)
+			ok = fputc(0, file) != EOF;
+		uint32_t riffSize = (uint32_t)(36 + dataBytes + (dataBytes & 1));
+		uint32_t dataSize = (uint32_t)dataBytes;
+		ok = ok && fseek(file, 4, SEEK_SET) == 0 && fwrite(&riffSize, 4, 1, file) == 1;
+		ok = ok && fseek(file, 40, SEEK_SET) == 0 && fwrite(&dataSize, 4, 1, file) == 1;
+		ok = fclose(file) == 0 && ok;
+		file = nullptr;
+		dataBytes = 0;
+		return ok;
+	}
+
+private:
+	void encodeSample(float sample, uint8_t* p) const
+	{
+		if (bitDepth == 32)
+		{
+			memcpy(p, &sample, 4);
+			return;
+		}
+		double scale = bitDepth == 16 ? 32768.0 : 8388608.0;
+		double scaled = sample * scale;
+		scaled = scaled < -scale ? -scale : (scaled > scale - 1.0 ? scale - 1.0 : scaled);
+		int32_t value = (int32_t)(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+		p[0] = (uint8_t)value;
+		p[1] = (uint8_t)(value >> 8);
+		if (bitDepth == 24)
+			p[2] = (uint8_t)(value >> 16);
+	}
+
+	FILE* file = nullptr;
+	std::vector<uint8_t> interleaved;
+	uint32_t numChannels = 0;
+	uint32_t bitDepth = 32;
+	uint64_t dataBytes = 0;
+};
+
+#endif
@@ -0,0 +1,967 @@
+// -----------------------------------------------------------------------------
+//    Echoplex microbenchmarks:  echoplex_bench.cpp
+//
+/**
+    \file   echoplex_bench.cpp
+    \brief  ns/sample and samples/second for each PluginObjects DSP object and for the full
+    		PluginCore chain, over sample rates and block sizes, written as JSON
+
+    echoplex_bench [options]
+
+    	--json <file>			write results here (default: stdout)
+    	--objects <a,b,...>		only objects whose name contains one of these
+    	--rates <r,r,...>		sample rates (default 44100,48000,96000,192000)
+    	--blocks <n,n,...>		block sizes (default 1,2,4 ... 4096)
+    	--min-time <seconds>	timed run per case (default 0.05)
+    	--label <text>			free text stored with the results (machine, build flags...)
+    	--uidesc <file>			editor description for the gui_open measurements
+    							(default: Resources/PluginGUI.uidesc of the source tree)
+    	--list					print the object and measurement names and exit
+
+    Per-sample objects render a block, then have their parameters re-applied, as PluginCore
+    does for an automated control, so block size is the parameter update interval; block
+    objects (UCombFilter, PluginCore) get the block in one call. Each case is timed in
+    batches after a warm-up and the fastest batch is reported (ns_per_sample), with the mean
+    over all batches alongside (ns_per_sample_mean).
+
+    Object cost drifts with data (denormals, modulated delay positions), so compare results
+    from the same build settings and --min-time.
+
+    After the objects come the measurements, named values rather than a throughput (filtered
+    by --objects too; their rate and block are fixed):
+
+    	interpolation/<name>	TapeReadHead reading a sine at 48 kHz while its delay sweeps
+    							every fraction: peak error at 1 kHz, and per frequency the
+    							passband gain and everything else (images, aliasing, phase
+    							wobble) relative to the signal
+    	reset/100_instances		PluginCore::reset() per instance, 100 instances: idle, after a
+    							second of audio, and a 48 -> 96 kHz rate change
+    	state/save_load			state chunk size, getStateChunk() and setStateChunk() + reset()
+    							after two seconds of audio
+    	gui_open/controls		the parameter side of building the editor's controls: for every
+    							control in the uidesc bound to a parameter, find it by tag and
+    							read what the control is set up from (range, default, value,
+    							label text, option menu entries) - through the core's
+    							GUIParameterView, against the per-open deep copy the wrapper
+    							used to make
+    	gui_open/description	the editor description: bytes VSTGUI parses for the full uidesc
+    							and the compiled layout, the one-off compile (first open, on the
+    							cache's worker) and the cached lookup (every later open); the
+    							layout is compiled into echoplex_bench_uicache/ in the current
+    							folder, not the user's cache
+
+    The VSTGUI side of an editor open (parsing, view creation, PNG decoding) needs the SDK's GUI
+    and a window, so it isn't in here.
+*/
+// -----------------------------------------------------------------------------
+#include "PluginCore.h"
+#include "OfflineProcessor.h"
+#include "LFOEx.h"
+#include "TrippleLFO.h"
+#include "noisegen.h"
+#include "SystemNoiseGen.h"
+#include "UniversalComb.h"
+#include "EchoplexDelayModulator.h"
+#include "TapeReadHead.h"
+#include "StereoTapeBuffer.h"
+#include "UIDescriptionCache.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef ECHOPLEX_REVISION
+#define ECHOPLEX_REVISION "unknown"
+#endif
+
+#ifndef ECHOPLEX_UIDESC_PATH
+#define ECHOPLEX_UIDESC_PATH "Resources/PluginGUI.uidesc"
+#endif
+
+/** results are summed in here so the optimizer can't drop the work */
+static volatile double benchmarkSink = 0.0;
+
+/** one (object, rate, block) case, set up by its factory; run() renders one block */
+struct BenchmarkCase
+{
+	std::function<void()> run;
+};
+
+/** builds a case for an object at a sample rate and block size */
+typedef std::function<BenchmarkCase(double sampleRate, uint32_t blockSize)> BenchmarkFactory;
+
+struct BenchmarkObject
+{
+	std::string name;
+	BenchmarkFactory factory;
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	double sampleRate = 0.0;
+	uint32_t blockSize = 0;
+	uint64_t samples = 0;
+	double nsPerSample = 0.0;		///< fastest batch
+	double nsPerSampleMean = 0.0;	///< all batches
+};
+
+/** one measurement: named values, in the order they were taken */
+struct MeasurementResult
+{
+	std::string name;
+	std::vector<std::pair<std::string, double>> values;
+
+	void add(const std::string& key, double value) { values.push_back(std::make_pair(key, value)); }
+};
+
+typedef std::function<void(MeasurementResult&)> MeasurementFunction;
+
+struct Measurement
+{
+	std::string name;
+	MeasurementFunction measure;
+};
+
+/** the Echoplex delay range, swept slowly so the tape objects read at moving fractional positions */
+class DelaySweep
+{
+public:
+	explicit DelaySweep(double sampleRate) : increment(2.0 * kPi * 0.5 / sampleRate), samplesPerMSec(sampleRate / 1000.0) {}	/* C-TOR */
+
+	inline double next_Samples()
+	{
+		phase += increment;
+		if (phase > 2.0 * kPi)
+			phase -= 2.0 * kPi;
+		return (385.0 + 295.0 * sin(phase)) * samplesPerMSec;
+	}
+
+private:
+	double phase = 0.0;
+	double increment = 0.0;
+	double samplesPerMSec = 0.0;
+};
+
+/** deterministic test input: a quiet sawtooth, no denormals, no silence */
+static void fillInput(std::vector<double>& input)
+{
+	for (size_t i = 0; i < input.size(); i++)
+		input[i] = 0.25 * ((double)(i % 109) / 54.5 - 1.0);
+}
+
+static const char* getInterpolationName(TapeInterpolation interpolation)
+{
+	switch (interpolation)
+	{
+		case TapeInterpolation::linear: return "linear";
+		case TapeInterpolation::hermite: return "hermite";
+		case TapeInterpolation::lagrange4: return "lagrange4";
+		case TapeInterpolation::lagrange6: return "lagrange6";
+		case TapeInterpolation::thiran: return "thiran";
+		case TapeInterpolation::windowedSinc: return "windowedSinc";
+	}
+	return "unknown";
+}
+
+static std::vector<BenchmarkObject> makeBenchmarkObjects()
+{
+	std::vector<BenchmarkObject> objects;
+
+	objects.push_back({ "LFO_Ex", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<LFO_Ex> lfo = std::make_shared<LFO_Ex>();
+		LFO_ExParameters params = lfo->getParameters();
+		params.frequency_Hz = 2.5;
+		params.waveform = generatorWaveform::kSin;
+		lfo->setParameters(params);
+		lfo->reset(sampleRate);
+		return BenchmarkCase{ [lfo, params, blockSize]()
+		{
+			double sum = 0.0;
+			for (uint32_t i = 0; i < blockSize; i++)
+				sum += lfo->renderAudioOutput().normalOutput;
+			lfo->setParameters(params);
+			benchmarkSink = benchmarkSink + sum;
+		} };
+	} });
+
+	objects.push_back({ "TrippleLFO", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<TrippleLFO> lfo = std::make_shared<TrippleLFO>();
+		lfo->reset(sampleRate);
+		TrippleLFOParameters params = lfo->getParameters();
+		return BenchmarkCase{ [lfo, params, blockSize]()
+		{
+			double sum = 0.0;
+			for (uint32_t i = 0; i < blockSize; i++)
+				sum += lfo->renderAudioOutput().normalOutput;
+			lfo->setParameters(params);
+			benchmarkSink = benchmarkSink + sum;
+		} };
+	} });
+
+	objects.push_back({ "NoiseGenerator", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<NoiseGenerator> noise = std::make_shared<NoiseGenerator>();
+		noise->reset(sampleRate);
+		NoiseGeneratorParameters params = noise->getParameters();
+		return BenchmarkCase{ [noise, params, blockSize]()
+		{
+			double sum = 0.0;
+			for (uint32_t i = 0; i < blockSize; i++)
+			{
+				NoiseGenData data = noise->renderAudioOutput();
+				sum += data.filteredWhiteNoiseOut + data.filteredgaussianNoiseOut + data.filteredPinkNoiseOut;
+			}
+			noise->setParameters(params);
+			benchmarkSink = benchmarkSink + sum;
+		} };
+	} });
+
+	objects.push_back({ "SystemNoiseGen", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<SystemNoiseGen> noise = std::make_shared<SystemNoiseGen>();
+		noise->reset(sampleRate);
+		SystemNoiseGenParameters params = noise->getParameters();
+		return BenchmarkCase{ [noise, params, blockSize]()
+		{
+			double sum = 0.0;
+			for (uint32_t i = 0; i < blockSize; i++)
+				sum += noise->renderAudioOutput().normalOutput;
+			noise->setParameters(params);
+			benchmarkSink = benchmarkSink + sum;
+		} };
+	} });
+
+	objects.push_back({ "UCombFilter", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<UCombFilter> comb = std::make_shared<UCombFilter>();
+		UCombFilterParameters params = comb->getParameters();
+		params.combFilterType = CombFilterType::inverseCombFilter;
+		params.delayTime_mSec = 10.0;
+		params.feedbackGain = 0.5;
+		params.maxDelayTime_mSec = 20.0;
+		comb->setParameters(params);
+		comb->reset(sampleRate);
+		std::shared_ptr<std::vector<double>> input = std::make_shared<std::vector<double>>(blockSize);
+		std::shared_ptr<std::vector<double>> output = std::make_shared<std::vector<double>>(blockSize);
+		fillInput(*input);
+		return BenchmarkCase{ [comb, params, input, output, blockSize]()
+		{
+			comb->processAudioBlock(input->data(), output->data(), blockSize);
+			comb->setParameters(params);
+			benchmarkSink = benchmarkSink + (*output)[blockSize - 1];
+		} };
+	} });
+
+	objects.push_back({ "EchoplexDelayModulator", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<EchoplexDelayModulator> modulator = std::make_shared<EchoplexDelayModulator>();
+		EchoplexDelayModulatorParameters params = modulator->getParameters();
+		params.delayTime = 350.0;
+		modulator->setParameters(params);
+		modulator->reset(sampleRate);
+		return BenchmarkCase{ [modulator, params, blockSize]()
+		{
+			double sum = 0.0;
+			for (uint32_t i = 0; i < blockSize; i++)
+				sum += modulator->renderAudioOutput().normalOutput;
+			modulator->setParameters(params);
+			benchmarkSink = benchmarkSink + sum;
+		} };
+	} });
+
+	const TapeInterpolation interpolations[] = { TapeInterpolation::linear, TapeInterpolation::hermite, TapeInterpolation::lagrange4,
+		TapeInterpolation::lagrange6, TapeInterpolation::thiran, TapeInterpolation::windowedSinc };
+	for (TapeInterpolation interpolation : interpolations)
+	{
+		objects.push_back({ std::string("TapeReadHead/") + getInterpolationName(interpolation), [interpolation](double sampleRate, uint32_t blockSize)
+		{
+			std::shared_ptr<TapeReadHead> tape = std::make_shared<TapeReadHead>();
+			TapeReadHeadParameters params = tape->getParameters();
+			params.interpolation = interpolation;
+			tape->setParameters(params);
+			tape->createDelayBuffer(sampleRate, 750.0);
+			tape->reset(sampleRate);
+			std::shared_ptr<DelaySweep> sweep = std::make_shared<DelaySweep>(sampleRate);
+			std::shared_ptr<std::vector<double>> input = std::make_shared<std::vector<double>>(blockSize);
+			fillInput(*input);
+			return BenchmarkCase{ [tape, sweep, input, blockSize]()
+			{
+				double sum = 0.0;
+				for (uint32_t i = 0; i < blockSize; i++)
+				{
+					tape->writeDelay((*input)[i]);
+					sum += tape->readDelayAtSamples(sweep->next_Samples());
+				}
+				benchmarkSink = benchmarkSink + sum;
+			} };
+		} });
+	}
+
+	for (TapeInterpolation interpolation : interpolations)
+	{
+		objects.push_back({ std::string("StereoTapeBuffer/") + getInterpolationName(interpolation), [interpolation](double sampleRate, uint32_t blockSize)
+		{
+			std::shared_ptr<StereoTapeBuffer> tape = std::make_shared<StereoTapeBuffer>();
+			StereoTapeBufferParameters params = tape->getParameters();
+			params.interpolation = interpolation;
+			tape->setParameters(params);
+			tape->createDelayBuffer(sampleRate, 750.0);
+			std::shared_ptr<DelaySweep> sweep = std::make_shared<DelaySweep>(sampleRate);
+			std::shared_ptr<std::vector<double>> input = std::make_shared<std::vector<double>>(blockSize);
+			fillInput(*input);
+			return BenchmarkCase{ [tape, sweep, input, blockSize]()
+			{
+				double sum = 0.0;
+				for (uint32_t i = 0; i < blockSize; i++)
+				{
+					double left = 0.0, right = 0.0;
+					tape->writeFrame((*input)[i], -(*input)[i]);
+					tape->readFrameAtSamples(sweep->next_Samples(), left, right);
+					sum += left + right;
+				}
+				benchmarkSink = benchmarkSink + sum;
+			} };
+		} });
+	}
+
+	objects.push_back({ "PluginCore", [](double sampleRate, uint32_t blockSize)
+	{
+		std::shared_ptr<PluginCore> core = std::make_shared<PluginCore>();
+		PluginInfo pluginInfo;
+		core->initialize(pluginInfo);
+		std::shared_ptr<OfflineProcessor> processor = std::make_shared<OfflineProcessor>(*core, blockSize);
+		processor->reset(sampleRate);
+		std::vector<double> input(blockSize);
+		fillInput(input);
+		for (uint32_t i = 0; i < blockSize; i++)
+		{
+			processor->getInputs()[0][i] = (float)input[i];
+			processor->getInputs()[1][i] = (float)-input[i];
+		}
+		return BenchmarkCase{ [core, processor, blockSize]()
+		{
+			processor->process(blockSize);
+			benchmarkSink = benchmarkSink + processor->getOutputs()[0][blockSize - 1];
+		} };
+	} });
+
+	return objects;
+}
+
+/** microseconds per call of work: the fastest of repeats, and the mean */
+static void timeCalls(uint32_t repeats, const std::function<void()>& work, double& fastest_uSec, double& mean_uSec)
+{
+	typedef std::chrono::steady_clock Clock;
+	double total_Sec = 0.0;
+	double best_Sec = -1.0;
+	for (uint32_t i = 0; i < repeats; i++)
+	{
+		Clock::time_point start = Clock::now();
+		work();
+		double elapsed_Sec = std::chrono::duration<double>(Clock::now() - start).count();
+		best_Sec = best_Sec < 0.0 || elapsed_Sec < best_Sec ? elapsed_Sec : best_Sec;
+		total_Sec += elapsed_Sec;
+	}
+	fastest_uSec = best_Sec * 1.0e6;
+	mean_uSec = repeats ? total_Sec * 1.0e6 / repeats : 0.0;
+}
+
+/**
+read a unit sine through a TapeReadHead whose delay sweeps 10 samples either side of 200.5,
+slowly enough to pass every fraction many times; the ideal output is the sine at the exact
+(fractional) read position. The output is split into the part along the ideal sine and its
+quadrature (passband gain) and the rest (images, aliasing, the phase wobble of a fraction-
+dependent delay error).
+*/
+static void measureInterpolation(TapeInterpolation interpolation, double frequency_Hz, double& peakError, double& passband_dB, double& residual_dB)
+{
+	const double sampleRate = 48000.0;
+	const uint32_t settle = 4800;
+	const uint32_t length = 96000;
+
+	TapeReadHead tape;
+	TapeReadHeadParameters params = tape.getParameters();
+	params.interpolation = interpolation;
+	tape.setParameters(params);
+	tape.createDelayBuffer(sampleRate, 100.0);
+
+	double w = 2.0 * kPi * frequency_Hz / sampleRate;
+	double sweep = 2.0 * kPi * 0.37 / sampleRate;
+	std::vector<double> output(length);
+	std::vector<double> phase(length);
+	peakError = 0.0;
+	for (uint32_t n = 0; n < settle + length; n++)
+	{
+		tape.writeDelay(sin(w * n));
+		double delay_Samples = 200.5 + 10.0 * sin(sweep * n);
+		double y = tape.readDelayAtSamples(delay_Samples);
+		if (n < settle)
+			continue;
+
+		// --- after writing x[n], a read at delay d is x[n + 1 - d]
+		output[n - settle] = y;
+		phase[n - settle] = w * ((double)n + 1.0 - delay_Samples);
+		double error = fabs(y - sin(phase[n - settle]));
+		peakError = error > peakError ? error : peakError;
+	}
+
+	// --- least squares fit of a * sin + b * cos at the ideal phase, then what's left over
+	double cc = 0.0, ss = 0.0, cs = 0.0, yc = 0.0, ys = 0.0;
+	for (uint32_t i = 0; i < length; i++)
+	{
+		double c = sin(phase[i]);
+		double q = cos(phase[i]);
+		cc += c * c; ss += q * q; cs += c * q; yc += output[i] * c; ys += output[i] * q;
+	}
+	double determinant = cc * ss - cs * cs;
+	double a = (yc * ss - ys * cs) / determinant;
+	double b = (ys * cc - yc * cs) / determinant;
+	double residual = 0.0;
+	for (uint32_t i = 0; i < length; i++)
+	{
+		double e = output[i] - a * sin(phase[i]) - b * cos(phase[i]);
+		residual += e * e;
+	}
+	passband_dB = 20.0 * log10(sqrt(a * a + b * b));
+	residual_dB = 10.0 * log10((residual > 1.0e-30 ? residual : 1.0e-30) / cc);
+}
+
+/** a core initialized and reset at 48 kHz, with a quiet sawtooth in its input blocks */
+struct CoreUnderTest
+{
+	CoreUnderTest(uint32_t blockSize)	/* C-TOR */
+		: core(new PluginCore)
+	{
+		PluginInfo pluginInfo;
+		core->initialize(pluginInfo);
+		processor.reset(new OfflineProcessor(*core, blockSize));
+		processor->reset(48000.0);
+		std::vector<double> input(blockSize);
+		fillInput(input);
+		for (uint32_t i = 0; i < blockSize; i++)
+		{
+			processor->getInputs()[0][i] = (float)input[i];
+			processor->getInputs()[1][i] = (float)-input[i];
+		}
+	}
+
+	void run(double seconds)
+	{
+		uint32_t blockSize = processor->getMaxBlockSize();
+		uint64_t blocks = (uint64_t)ceil(seconds * 48000.0 / blockSize);
+		for (uint64_t i = 0; i < blocks; i++)
+			processor->process(blockSize);
+	}
+
+	std::unique_ptr<PluginCore> core;
+	std::unique_ptr<OfflineProcessor> processor;
+};
+
+/** the tag of every control the editor description creates for a parameter, in document order */
+static std::vector<uint32_t> readControlTags(const std::string& uidesc)
+{
+	std::map<std::string, uint32_t> tagsByName;
+	const std::string declaration = "<control-tag name=\"";
+	for (size_t at = uidesc.find(declaration); at != std::string::npos; at = uidesc.find(declaration, at + 1))
+	{
+		size_t nameStart = at + declaration.size();
+		size_t nameEnd = uidesc.find('"', nameStart);
+		size_t tag = uidesc.find("tag=\"", nameEnd);
+		if (nameEnd != std::string::npos && tag != std::string::npos)
+			tagsByName[uidesc.substr(nameStart, nameEnd - nameStart)] = (uint32_t)strtoul(uidesc.c_str() + tag + 5, nullptr, 10);
+	}
+
+	std::vector<uint32_t> controlTags;
+	const std::string attribute = " control-tag=\"";
+	for (size_t at = uidesc.find(attribute); at != std::string::npos; at = uidesc.find(attribute, at + 1))
+	{
+		size_t nameStart = at + attribute.size();
+		size_t nameEnd = uidesc.find('"', nameStart);
+		auto tag = tagsByName.find(uidesc.substr(nameStart, nameEnd - nameStart));
+		if (tag != tagsByName.end())
+			controlTags.push_back(tag->second);
+	}
+	return controlTags;
+}
+
+/** what building one control reads from its parameter: range, default and value, label text, option menu entries */
+static double readControlSetup(const GUIParameterDescriptor& descriptor, double valueNormalized)
+{
+	double range = descriptor.maxValue - descriptor.minValue;
+	double defaultNormalized = range != 0.0 ? (descriptor.defaultValue - descriptor.minValue) / range : 0.0;
+	size_t text = strlen(descriptor.name) + strlen(descriptor.units);
+	uint32_t entries = 0;
+	if (descriptor.variableType == controlVariableType::kTypedEnumStringList)
+	{
+		entries = 1;
+		for (const char* c = descriptor.stringList; *c; c++)
+			entries += *c == ',';
+	}
+	return valueNormalized + defaultNormalized + (double)text + entries;
+}
+
+static std::vector<Measurement> makeMeasurements(const std::string& uidescPath)
+{
+	std::vector<Measurement> measurements;
+
+	const TapeInterpolation interpolations[] = { TapeInterpolation::linear, TapeInterpolation::hermite, TapeInterpolation::lagrange4,
+		TapeInterpolation::lagrange6, TapeInterpolation::thiran, TapeInterpolation::windowedSinc };
+	for (TapeInterpolation interpolation : interpolations)
+	{
+		measurements.push_back({ std::string("interpolation/") + getInterpolationName(interpolation), [interpolation](MeasurementResult& result)
+		{
+			const struct { const char* suffix; double frequency_Hz; } frequencies[] = { { "1k", 1000.0 }, { "10k", 10000.0 }, { "20k", 20000.0 } };
+			for (const auto& f : frequencies)
+			{
+				double peakError = 0.0, passband_dB = 0.0, residual_dB = 0.0;
+				measureInterpolation(interpolation, f.frequency_Hz, peakError, passband_dB, residual_dB);
+				if (f.frequency_Hz == 1000.0)
+					result.add("peak_error_1k", peakError);
+				result.add(std::string("passband_dB_") + f.suffix, passband_dB);
+				result.add(std::string("residual_dB_") + f.suffix, residual_dB);
+			}
+		} });
+	}
+
+	measurements.push_back({ "reset/100_instances", [](MeasurementResult& result)
+	{
+		typedef std::chrono::steady_clock Clock;
+		std::vector<std::unique_ptr<CoreUnderTest>> instances;
+		for (uint32_t i = 0; i < 100; i++)
+			instances.emplace_back(new CoreUnderTest(64));
+
+		// --- each instance reset in turn, as a host does on a transport or rate change
+		auto resetAll = [&instances](double sampleRate, const char* key, MeasurementResult& result)
+		{
+			double total_Sec = 0.0;
+			double worst_Sec = 0.0;
+			for (auto& instance : instances)
+			{
+				Clock::time_point start = Clock::now();
+				instance->processor->reset(sampleRate);
+				double elapsed_Sec = std::chrono::duration<double>(Clock::now() - start).count();
+				total_Sec += elapsed_Sec;
+				worst_Sec = elapsed_Sec > worst_Sec ? elapsed_Sec : worst_Sec;
+			}
+			result.add(std::string("reset_us_mean_") + key, total_Sec * 1.0e6 / instances.size());
+			result.add(std::string("reset_us_max_") + key, worst_Sec * 1.0e6);
+		};
+		resetAll(48000.0, "idle", result);
+		for (auto& instance : instances)
+			instance->run(1.0);
+		resetAll(48000.0, "after_audio", result);
+		resetAll(96000.0, "rate_change", result);
+		result.add("delay_memory_bytes", (double)instances[0]->core->getDelayMemoryBytes());
+	} });
+
+	measurements.push_back({ "state/save_load", [](MeasurementResult& result)
+	{
+		CoreUnderTest source(64);
+		source.run(2.0);
+		std::vector<uint8_t> chunk;
+		std::vector<uint8_t> parametersOnly;
+		source.core->getStateChunk(parametersOnly, false, false);
+		source.core->getStateChunk(chunk, true, true);
+		result.add("chunk_bytes", (double)chunk.size());
+		result.add("chunk_bytes_parameters_only", (double)parametersOnly.size());
+
+		double fastest_uSec = 0.0, mean_uSec = 0.0;
+		timeCalls(20, [&source, &chunk]() { source.core->getStateChunk(chunk, true, true); }, fastest_uSec, mean_uSec);
+		result.add("save_us", fastest_uSec);
+		result.add("save_us_mean", mean_uSec);
+
+		// --- a restore lands when the host resets the restored instance
+		CoreUnderTest restored(64);
+		bool loaded = true;
+		timeCalls(20, [&restored, &chunk, &loaded]()
+		{
+			loaded = restored.core->setStateChunk(chunk.data(), chunk.size()) && loaded;
+			restored.processor->reset(48000.0);
+		}, fastest_uSec, mean_uSec);
+		result.add("load_us", loaded ? fastest_uSec : -1.0);
+		result.add("load_us_mean", loaded ? mean_uSec : -1.0);
+	} });
+
+	measurements.push_back({ "gui_open/controls", [uidescPath](MeasurementResult& result)
+	{
+		std::string source;
+		if (!UIDescriptionCache::readFile(uidescPath, source))
+		{
+			fprintf(stderr, "echoplex_bench: can't read %s (see --uidesc)\n", uidescPath.c_str());
+			result.add("controls", -1.0);
+			return;
+		}
+		CoreUnderTest instance(64);
+		PluginCore& core = *instance.core;
+		std::vector<uint32_t> controlTags = readControlTags(source);
+		result.add("parameters", (double)core.getPluginParameterCount());
+		result.add("controls", (double)controlTags.size());
+
+		// --- before: a heap copy of every parameter per open, searched by tag while the controls were made
+		double fastest_uSec = 0.0, mean_uSec = 0.0;
+		timeCalls(200, [&core, &controlTags]()
+		{
+			std::vector<PluginParameter*>* parameters = core.makePluginParameterVectorCopy();
+			for (uint32_t tag : controlTags)
+			{
+				for (PluginParameter* parameter : *parameters)
+				{
+					if (parameter->getControlID() != tag)
+						continue;
+					GUIParameterDescriptor descriptor;
+					descriptor.name = parameter->getControlName();
+					descriptor.units = parameter->getControlUnits();
+					descriptor.stringList = parameter->getCommaSeparatedStringList();
+					descriptor.variableType = parameter->getControlVariableType();
+					descriptor.minValue = parameter->getMinValue();
+					descriptor.maxValue = parameter->getMaxValue();
+					descriptor.defaultValue = parameter->getDefaultValue();
+					benchmarkSink = benchmarkSink + readControlSetup(descriptor, parameter->getControlValueNormalized());
+					break;
+				}
+			}
+			for (PluginParameter* parameter : *parameters)
+				delete parameter;
+			delete parameters;
+		}, fastest_uSec, mean_uSec);
+		result.add("deep_copy_us", fastest_uSec);
+
+		// --- now: the same reads through the core's view
+		const GUIParameterView& view = core.getGUIParameterView();
+		timeCalls(200, [&view, &controlTags]()
+		{
+			for (uint32_t tag : controlTags)
+			{
+				int32_t index = view.findIndex(tag);
+				if (index >= 0)
+					benchmarkSink = benchmarkSink + readControlSetup(view.getDescriptor(index), view.getValueNormalized(index));
+			}
+		}, fastest_uSec, mean_uSec);
+		result.add("view_us", fastest_uSec);
+	} });
+
+	measurements.push_back({ "gui_open/description", [uidescPath](MeasurementResult& result)
+	{
+		std::string source;
+		if (!UIDescriptionCache::readFile(uidescPath, source))
+		{
+			fprintf(stderr, "echoplex_bench: can't read %s (see --uidesc)\n", uidescPath.c_str());
+			result.add("full_bytes", -1.0);
+			return;
+		}
+
+		// --- compiled into a folder of our own, not the user's cache
+		std::string cacheDirectory = "echoplex_bench_uicache";
+		double fastest_uSec = 0.0, mean_uSec = 0.0;
+		std::string layoutPath;
+		timeCalls(1, [&]() { layoutPath = UIDescriptionCache::getCachedLayout(source, cacheDirectory); }, fastest_uSec, mean_uSec);
+		std::string layout;
+		if (layoutPath.empty() || !UIDescriptionCache::readFile(layoutPath, layout))
+		{
+			fprintf(stderr, "echoplex_bench: can't compile the layout into %s\n", cacheDirectory.c_str());
+			result.add("full_bytes", (double)source.size());
+			result.add("layout_bytes", -1.0);
+			return;
+		}
+		std::string outputDirectory = layoutPath.substr(0, layoutPath.find_last_of("/\\"));
+
+		result.add("full_bytes", (double)source.size());
+		result.add("layout_bytes", (double)layout.size());
+		timeCalls(10, [&]() { UIDescriptionCache::compile(source, outputDirectory, layoutPath); }, fastest_uSec, mean_uSec);
+		result.add("compile_us", fastest_uSec);
+		timeCalls(100, [&]() { benchmarkSink = benchmarkSink + (double)UIDescriptionCache::getCachedLayout(source, cacheDirectory).size(); }, fastest_uSec, mean_uSec);
+		result.add("cached_lookup_us", fastest_uSec);
+
+		// --- what the editor reads from disk before VSTGUI starts parsing
+		std::string contents;
+		timeCalls(20, [&]() { UIDescriptionCache::readFile(uidescPath, contents); }, fastest_uSec, mean_uSec);
+		result.add("full_read_us", fastest_uSec);
+		timeCalls(20, [&]() { UIDescriptionCache::readFile(layoutPath, contents); }, fastest_uSec, mean_uSec);
+		result.add("layout_read_us", fastest_uSec);
+	} });
+
+	return measurements;
+}
+
+/**
+time one case: warm up, then batches of whole blocks (each at least ~1/16 of minTime_Sec)
+until minTime_Sec of timed work has been done
+*/
+static BenchmarkResult runCase(const BenchmarkObject& object, double sampleRate, uint32_t blockSize, double minTime_Sec)
+{
+	typedef std::chrono::steady_clock Clock;
+	BenchmarkCase benchmarkCase = object.factory(sampleRate, blockSize);
+
+	// --- warm-up: caches, branch predictors, lazily built tables, and a batch size estimate
+	uint64_t blocksPerBatch = 1;
+	double elapsed_Sec = 0.0;
+	for (;;)
+	{
+		Clock::time_point start = Clock::now();
+		for (uint64_t i = 0; i < blocksPerBatch; i++)
+			benchmarkCase.run();
+		elapsed_Sec = std::chrono::duration<double>(Clock::now() - start).count();
+		if (elapsed_Sec >= minTime_Sec / 16.0 && blocksPerBatch * blockSize >= 4096)
+			break;
+		blocksPerBatch *= 2;
+	}
+
+	BenchmarkResult result;
+	result.name = object.name;
+	result.sampleRate = sampleRate;
+	result.blockSize = blockSize;
+	double best_Sec = -1.0;
+	double total_Sec = 0.0;
+	while (total_Sec < minTime_Sec)
+	{
+		Clock::time_point start = Clock::now();
+		for (uint64_t i = 0; i < blocksPerBatch; i++)
+			benchmarkCase.run();
+		double batch_Sec = std::chrono::duration<double>(Clock::now() - start).count();
+		best_Sec = best_Sec < 0.0 || batch_Sec < best_Sec ? batch_Sec : best_Sec;
+		total_Sec += batch_Sec;
+		result.samples += blocksPerBatch * blockSize;
+	}
+	result.nsPerSample = best_Sec * 1.0e9 / (double)(blocksPerBatch * blockSize);
+	result.nsPerSampleMean = total_Sec * 1.0e9 / (double)result.samples;
+	return result;
+}
+
+/** comma separated numbers */
+static std::vector<double> parseList(const char* text)
+{
+	std::vector<double> values;
+	for (const char* p = text; *p;)
+	{
+		char* end = nullptr;
+		double value = strtod(p, &end);
+		if (end == p)
+			break;
+		values.push_back(value);
+		p = *end == ',' ? end + 1 : end;
+	}
+	return values;
+}
+
+static std::string jsonString(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		if ((unsigned char)c >= 0x20)
+			quoted += c;
+	}
+	return quoted + "\"";
+}
+
+/** best effort CPU model, for telling machines apart in the JSON */
+static std::string getCPUName()
+{
+	std::string name = "unknown";
+	FILE* cpuInfo = fopen("/proc/cpuinfo", "r");
+	if (!cpuInfo)
+		return name;
+	char line[512];
+	while (fgets(line, sizeof(line), cpuInfo))
+	{
+		const char* colon = strchr(line, ':');
+		if (strncmp(line, "model name", 10) != 0 || !colon)
+			continue;
+		name = colon + 1 + (colon[1] == ' ' ? 1 : 0);
+		while (!name.empty() && (name.back() == '\n' || name.back() == '\r'))
+			name.pop_back();
+		break;
+	}
+	fclose(cpuInfo);
+	return name;
+}
+
+static std::string getCompilerName()
+{
+#if defined(_MSC_VER)
+	return "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__VERSION__)
+	return __VERSION__;
+#else
+	return "unknown";
+#endif
+}
+
+static void writeJSON(FILE* file, const std::string& label, double minTime_Sec, const std::vector<BenchmarkResult>& results,
+	const std::vector<MeasurementResult>& measurements)
+{
+	char timestamp[32] = "";
+	time_t now = time(nullptr);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"benchmark\": \"echoplex_bench\",\n");
+	fprintf(file, "\t\"format_version\": 2,\n");
+	fprintf(file, "\t\"revision\": %s,\n", jsonString(ECHOPLEX_REVISION).c_str());
+	fprintf(file, "\t\"label\": %s,\n", jsonString(label).c_str());
+	fprintf(file, "\t\"timestamp\": \"%s\",\n", timestamp);
+	fprintf(file, "\t\"cpu\": %s,\n", jsonString(getCPUName()).c_str());
+	fprintf(file, "\t\"compiler\": %s,\n", jsonString(getCompilerName()).c_str());
+	fprintf(file, "\t\"min_time_sec\": %g,\n", minTime_Sec);
+	fprintf(file, "\t\"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		double samplesPerSecond = r.nsPerSample > 0.0 ? 1.0e9 / r.nsPerSample : 0.0;
+		fprintf(file, "\t\t{ \"object\": %s, \"sample_rate\": %g, \"block_size\": %u, \"ns_per_sample\": %.4f, "
+			"\"ns_per_sample_mean\": %.4f, \"samples_per_second\": %.0f, \"realtime_factor\": %.2f, \"samples\": %llu }%s\n",
+			jsonString(r.name).c_str(), r.sampleRate, r.blockSize, r.nsPerSample, r.nsPerSampleMean,
+			samplesPerSecond, samplesPerSecond / r.sampleRate, (unsigned long long)r.samples, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "\t],\n");
+	fprintf(file, "\t\"measurements\": [\n");
+	for (size_t i = 0; i < measurements.size(); i++)
+	{
+		const MeasurementResult& m = measurements[i];
+		fprintf(file, "\t\t{ \"name\": %s", jsonString(m.name).c_str());
+		for (const auto& value : m.values)
+			fprintf(file, ", %s: %.6g", jsonString(value.first).c_str(), value.second);
+		fprintf(file, " }%s\n", i + 1 < measurements.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+}
+
+static int usage()
+{
+	fprintf(stderr, "usage: echoplex_bench [--json file] [--objects a,b] [--rates r,r] [--blocks n,n] [--min-time sec] [--label text] [--uidesc file] [--list]\n");
+	return 2;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* jsonPath = nullptr;
+	std::vector<std::string> objectFilters;
+	std::vector<double> sampleRates = { 44100.0, 48000.0, 96000.0, 192000.0 };
+	std::vector<double> blockSizes;
+	for (uint32_t blockSize = 1; blockSize <= 4096; blockSize *= 2)
+		blockSizes.push_back(blockSize);
+	double minTime_Sec = 0.05;
+	std::string label;
+	std::string uidescPath = ECHOPLEX_UIDESC_PATH;
+	bool listOnly = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--list")
+			listOnly = true;
+		else if (arg == "--json" && hasValue)
+			jsonPath = argv[++i];
+		else if (arg == "--objects" && hasValue)
+		{
+			std::string list = argv[++i];
+			for (size_t start = 0; start <= list.size();)
+			{
+				size_t comma = list.find(',', start);
+				size_t end = comma == std::string::npos ? list.size() : comma;
+				if (end > start)
+					objectFilters.push_back(list.substr(start, end - start));
+				start = end + 1;
+			}
+		}
+		else if (arg == "--rates" && hasValue)
+			sampleRates = parseList(argv[++i]);
+		else if (arg == "--blocks" && hasValue)
+			blockSizes = parseList(argv[++i]);
+		else if (arg == "--min-time" && hasValue)
+			minTime_Sec = atof(argv[++i]);
+		else if (arg == "--label" && hasValue)
+			label = argv[++i];
+		else if (arg == "--uidesc" && hasValue)
+			uidescPath = argv[++i];
+		else
+			return usage();
+	}
+	if (sampleRates.empty() || blockSizes.empty() || minTime_Sec <= 0.0)
+		return usage();
+	for (double blockSize : blockSizes)
+	{
+		if (blockSize < 1.0 || blockSize > 65536.0)
+			return usage();
+	}
+
+	std::vector<BenchmarkObject> objects = makeBenchmarkObjects();
+	std::vector<Measurement> measurements = makeMeasurements(uidescPath);
+	if (listOnly)
+	{
+		for (const BenchmarkObject& object : objects)
+			printf("%s\n", object.name.c_str());
+		for (const Measurement& measurement : measurements)
+			printf("%s\n", measurement.name.c_str());
+		return 0;
+	}
+
+	auto isSelected = [&objectFilters](const std::string& name)
+	{
+		bool selected = objectFilters.empty();
+		for (const std::string& filter : objectFilters)
+			selected = selected || name.find(filter) != std::string::npos;
+		return selected;
+	};
+
+	std::vector<BenchmarkResult> results;
+	for (const BenchmarkObject& object : objects)
+	{
+		if (!isSelected(object.name))
+			continue;
+
+		for (double sampleRate : sampleRates)
+		{
+			for (double blockSize : blockSizes)
+			{
+				results.push_back(runCase(object, sampleRate, (uint32_t)blockSize, minTime_Sec));
+				const BenchmarkResult& r = results.back();
+				fprintf(stderr, "%-28s %7.0f Hz  block %5u  %9.2f ns/sample\n", r.name.c_str(), r.sampleRate, r.blockSize, r.nsPerSample);
+			}
+		}
+	}
+
+	std::vector<MeasurementResult> measurementResults;
+	for (const Measurement& measurement : measurements)
+	{
+		if (!isSelected(measurement.name))
+			continue;
+		MeasurementResult result;
+		result.name = measurement.name;
+		measurement.measure(result);
+		measurementResults.push_back(result);
+
+		fprintf(stderr, "%-28s", result.name.c_str());
+		for (const auto& value : result.values)
+			fprintf(stderr, " %s %.4g", value.first.c_str(), value.second);
+		fprintf(stderr, "\n");
+	}
+
+	FILE* file = jsonPath ? fopen(jsonPath, "w") : stdout;
+	if (!file)
+	{
+		fprintf(stderr, "echoplex_bench: can't write %s\n", jsonPath);
+		return 1;
+	}
+	writeJSON(file, label, minTime_Sec, results, measurementResults);
+	if (jsonPath && fclose(file) != 0)
+	{
+		fprintf(stderr, "echoplex_bench: write to %s failed\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
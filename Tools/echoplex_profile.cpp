@@ -0,0 +1,291 @@
+// -----------------------------------------------------------------------------
+//    Echoplex per-stage profile:  echoplex_profile.cpp
+//
+/**
+    \file   echoplex_profile.cpp
+    \brief  runs PluginCore offline and writes where its audio-thread time goes - parameter
+    		cooking, EchoplexDelayModulator, tape delay, I/O - as JSON, from the StageProfiler
+    		counters of an ECHOPLEX_STAGE_PROFILING build
+
+    echoplex_profile [options]
+
+    	--json <file>			write results here (default: stdout)
+    	--preset <name>			factory or bank preset to profile (default: the default patch)
+    	--rates <r,r,...>		sample rates (default 44100,48000,96000)
+    	--blocks <n,n,...>		block sizes (default 32,128,512)
+    	--seconds <s>			audio per case, after a 0.1 second warm-up (default 2)
+    	--label <text>			free text stored with the results (machine, build flags...)
+
+    Per case and stage: clock ticks and nanoseconds per sample, the stage's share of the
+    buffer time and its mean load (1.0 = the whole real-time budget); peak_load is the worst
+    single buffer, all stages together. The counters themselves cost a clock read per stage
+    boundary, a few per frame, so compare profiles with each other rather than with
+    echoplex_bench numbers.
+*/
+// -----------------------------------------------------------------------------
+#include "PluginCore.h"
+#include "OfflineProcessor.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if !ECHOPLEX_STAGE_PROFILING
+#error "echoplex_profile reads PluginCore::stageProfiler: build with ECHOPLEX_STAGE_PROFILING=1 (cmake -DECHOPLEX_STAGE_PROFILING=ON)"
+#endif
+
+#ifndef ECHOPLEX_REVISION
+#define ECHOPLEX_REVISION "unknown"
+#endif
+
+/** one (rate, block) run's counters */
+struct ProfileResult
+{
+	double sampleRate = 0.0;
+	uint32_t blockSize = 0;
+	uint64_t frames = 0;
+	uint64_t buffers = 0;
+	uint64_t ticks[kNumProfileStages] = { 0 };
+	float peakLoad = 0.f;
+};
+
+/** comma separated numbers */
+static std::vector<double> parseList(const char* text)
+{
+	std::vector<double> values;
+	for (const char* p = text; *p;)
+	{
+		char* end = nullptr;
+		double value = strtod(p, &end);
+		if (end == p)
+			break;
+		values.push_back(value);
+		p = *end == ',' ? end + 1 : end;
+	}
+	return values;
+}
+
+static bool runCase(const std::string& preset, double sampleRate, uint32_t blockSize, double seconds, ProfileResult& result)
+{
+	std::unique_ptr<PluginCore> core(new PluginCore);
+	PluginInfo pluginInfo;
+	core->initialize(pluginInfo);
+
+	OfflineProcessor processor(*core, blockSize);
+	processor.reset(sampleRate);
+	if (!preset.empty() && !core->applyPresetByName(preset.c_str()))
+		return false;
+
+	// --- non-silent input, so nothing in the chain can skip work
+	for (uint32_t i = 0; i < blockSize; i++)
+	{
+		double x = 0.5 * sin(2.0 * 3.14159265358979 * 440.0 * i / sampleRate);
+		processor.getInputs()[0][i] = (float)x;
+		processor.getInputs()[1][i] = (float)-x;
+	}
+
+	// --- warm-up: first-buffer cooking, cold caches and the smoothers settling aren't the steady state
+	uint64_t warmUpBlocks = (uint64_t)ceil(0.1 * sampleRate / blockSize);
+	for (uint64_t block = 0; block < warmUpBlocks; block++)
+		processor.process(blockSize);
+	core->stageProfiler.clearTotals();
+
+	uint64_t numBlocks = (uint64_t)ceil(seconds * sampleRate / blockSize);
+	float peakLoad = 0.f;
+	for (uint64_t block = 0; block < numBlocks; block++)
+	{
+		processor.process(blockSize);
+		float load = core->stageProfiler.getTotalLoad();
+		peakLoad = load > peakLoad ? load : peakLoad;
+	}
+
+	const StageProfiler& profiler = core->stageProfiler;
+	result.sampleRate = sampleRate;
+	result.blockSize = blockSize;
+	result.frames = profiler.getTotalFrames();
+	result.buffers = profiler.getBufferCount();
+	for (uint32_t stage = 0; stage < kNumProfileStages; stage++)
+		result.ticks[stage] = profiler.getTotalTicks(stage);
+	result.peakLoad = peakLoad;
+	return true;
+}
+
+static std::string jsonString(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		if ((unsigned char)c >= 0x20)
+			quoted += c;
+	}
+	return quoted + "\"";
+}
+
+/** best effort CPU model, for telling machines apart in the JSON */
+static std::string getCPUName()
+{
+	std::string name = "unknown";
+	FILE* cpuInfo = fopen("/proc/cpuinfo", "r");
+	if (!cpuInfo)
+		return name;
+	char line[512];
+	while (fgets(line, sizeof(line), cpuInfo))
+	{
+		const char* colon = strchr(line, ':');
+		if (strncmp(line, "model name", 10) != 0 || !colon)
+			continue;
+		name = colon + 1 + (colon[1] == ' ' ? 1 : 0);
+		while (!name.empty() && (name.back() == '\n' || name.back() == '\r'))
+			name.pop_back();
+		break;
+	}
+	fclose(cpuInfo);
+	return name;
+}
+
+static std::string getCompilerName()
+{
+#if defined(_MSC_VER)
+	return "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__VERSION__)
+	return __VERSION__;
+#else
+	return "unknown";
+#endif
+}
+
+/** one stage (or the total) of one case: ticks over the case's frames */
+static void writeStage(FILE* file, const char* name, uint64_t ticks, uint64_t totalTicks, const ProfileResult& r, bool last)
+{
+	double ticksPerSample = r.frames ? (double)ticks / (double)r.frames : 0.0;
+	double nsPerSample = ticksPerSample * 1.0e9 / StageProfiler::getTicksPerSecond();
+	fprintf(file, "\t\t\t\t%s: { \"ticks_per_sample\": %.3f, \"ns_per_sample\": %.4f, \"share\": %.4f, \"load\": %.6f }%s\n",
+		jsonString(name).c_str(), ticksPerSample, nsPerSample, totalTicks ? (double)ticks / (double)totalTicks : 0.0,
+		nsPerSample * r.sampleRate * 1.0e-9, last ? "" : ",");
+}
+
+static void writeJSON(FILE* file, const std::string& label, const std::string& preset, double seconds, const std::vector<ProfileResult>& results)
+{
+	char timestamp[32] = "";
+	time_t now = time(nullptr);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"benchmark\": \"echoplex_profile\",\n");
+	fprintf(file, "\t\"format_version\": 1,\n");
+	fprintf(file, "\t\"revision\": %s,\n", jsonString(ECHOPLEX_REVISION).c_str());
+	fprintf(file, "\t\"label\": %s,\n", jsonString(label).c_str());
+	fprintf(file, "\t\"timestamp\": \"%s\",\n", timestamp);
+	fprintf(file, "\t\"cpu\": %s,\n", jsonString(getCPUName()).c_str());
+	fprintf(file, "\t\"compiler\": %s,\n", jsonString(getCompilerName()).c_str());
+	fprintf(file, "\t\"clock\": \"%s\",\n", StageProfiler::getClockName());
+	fprintf(file, "\t\"ticks_per_second\": %.0f,\n", StageProfiler::getTicksPerSecond());
+	fprintf(file, "\t\"preset\": %s,\n", jsonString(preset).c_str());
+	fprintf(file, "\t\"seconds\": %g,\n", seconds);
+	fprintf(file, "\t\"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const ProfileResult& r = results[i];
+		uint64_t totalTicks = 0;
+		for (uint32_t stage = 0; stage < kNumProfileStages; stage++)
+			totalTicks += r.ticks[stage];
+
+		fprintf(file, "\t\t{\n");
+		fprintf(file, "\t\t\t\"sample_rate\": %g, \"block_size\": %u, \"frames\": %llu, \"buffers\": %llu, \"peak_load\": %.6f,\n",
+			r.sampleRate, r.blockSize, (unsigned long long)r.frames, (unsigned long long)r.buffers, r.peakLoad);
+		fprintf(file, "\t\t\t\"stages\": {\n");
+		for (uint32_t stage = 0; stage < kNumProfileStages; stage++)
+			writeStage(file, StageProfiler::getStageName(stage), r.ticks[stage], totalTicks, r, false);
+		writeStage(file, "total", totalTicks, totalTicks, r, true);
+		fprintf(file, "\t\t\t}\n");
+		fprintf(file, "\t\t}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+}
+
+static int usage()
+{
+	fprintf(stderr, "usage: echoplex_profile [--json file] [--preset name] [--rates r,r] [--blocks n,n] [--seconds s] [--label text]\n");
+	return 2;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* jsonPath = nullptr;
+	std::string preset;
+	std::vector<double> sampleRates = { 44100.0, 48000.0, 96000.0 };
+	std::vector<double> blockSizes = { 32.0, 128.0, 512.0 };
+	double seconds = 2.0;
+	std::string label;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--json" && hasValue)
+			jsonPath = argv[++i];
+		else if (arg == "--preset" && hasValue)
+			preset = argv[++i];
+		else if (arg == "--rates" && hasValue)
+			sampleRates = parseList(argv[++i]);
+		else if (arg == "--blocks" && hasValue)
+			blockSizes = parseList(argv[++i]);
+		else if (arg == "--seconds" && hasValue)
+			seconds = atof(argv[++i]);
+		else if (arg == "--label" && hasValue)
+			label = argv[++i];
+		else
+			return usage();
+	}
+	if (sampleRates.empty() || blockSizes.empty() || seconds <= 0.0)
+		return usage();
+	for (double blockSize : blockSizes)
+	{
+		if (blockSize < 1.0 || blockSize > 65536.0)
+			return usage();
+	}
+
+	std::vector<ProfileResult> results;
+	for (double sampleRate : sampleRates)
+	{
+		for (double blockSize : blockSizes)
+		{
+			ProfileResult r;
+			if (!runCase(preset, sampleRate, (uint32_t)blockSize, seconds, r))
+			{
+				fprintf(stderr, "echoplex_profile: no preset named \"%s\"\n", preset.c_str());
+				return 1;
+			}
+			results.push_back(r);
+
+			uint64_t totalTicks = 0;
+			for (uint32_t stage = 0; stage < kNumProfileStages; stage++)
+				totalTicks += r.ticks[stage];
+			fprintf(stderr, "%7.0f Hz  block %5u ", r.sampleRate, r.blockSize);
+			for (uint32_t stage = 0; stage < kNumProfileStages; stage++)
+				fprintf(stderr, " %s %4.1f%%", StageProfiler::getStageName(stage), totalTicks ? 100.0 * r.ticks[stage] / totalTicks : 0.0);
+			fprintf(stderr, "  peak load %.3f\n", r.peakLoad);
+		}
+	}
+
+	FILE* file = jsonPath ? fopen(jsonPath, "w") : stdout;
+	if (!file)
+	{
+		fprintf(stderr, "echoplex_profile: can't write %s\n", jsonPath);
+		return 1;
+	}
+	writeJSON(file, label, preset, seconds, results);
+	if (jsonPath && fclose(file) != 0)
+	{
+		fprintf(stderr, "echoplex_profile: write to %s failed\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,335 @@
+// -----------------------------------------------------------------------------
+//    Echoplex offline renderer:  echoplex_render.cpp
+//
+/**
+    \file   echoplex_render.cpp
+    \brief  streams a WAV file through PluginCore (reset/processAudioBuffers) with
+    		no host shell or GUI, and reports the realtime factor
+
+    echoplex_render [options] input.wav output.wav
+
+    	--preset <name>				factory or bank preset, applied before any --param
+    	--param <control>=<value>	actual value; control is a name (case, spaces and
+    								punctuation ignored: "delaytime") or a control ID;
+    								list controls take an index or an item string
+    	--bank <file.epbk>			preset bank (default: Echoplex.epbk next to this tool)
+    	--block <frames>			buffer size (default 512)
+    	--tail <seconds>			render this much silence after the input (default 0)
+    	--bits <16|24|32>			output format; 32 is float (default 32)
+    	--load-state <file>			restore a --save-state chunk first, as a host restoring a
+    								session does (--preset and --param still apply on top)
+    	--save-state <file>			after rendering, save the state chunk: parameters, modulators
+    								and, when the tape object supports it, the tape contents
+    	--list						print controls and presets, then exit
+
+    Mono input is fed to both plugin inputs; output is always stereo.
+*/
+// -----------------------------------------------------------------------------
+#include "PluginCore.h"
+#include "OfflineProcessor.h"
+#include "WavFile.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** lower case letters and digits only, so "Delay Time", "delay_time" and "delaytime" all match */
+static std::string normalizeName(const char* name)
+{
+	std::string result;
+	for (; *name; name++)
+	{
+		if (isalnum((unsigned char)*name))
+			result += (char)tolower((unsigned char)*name);
+	}
+	return result;
+}
+
+static bool parseNumber(const std::string& text, double& value)
+{
+	char* end = nullptr;
+	value = strtod(text.c_str(), &end);
+	return !text.empty() && end && *end == '\0';
+}
+
+/** by control ID if the text is a number, else by normalized name */
+static PluginParameter* findParameter(PluginCore& core, const std::string& control)
+{
+	double id = 0.0;
+	if (parseNumber(control, id))
+		return core.getPluginParameterByControlID((uint32_t)id);
+
+	std::string wanted = normalizeName(control.c_str());
+	for (uint32_t i = 0; i < core.getPluginParameterCount(); i++)
+	{
+		PluginParameter* piParam = core.getPluginParameterByIndex(i);
+		if (piParam && normalizeName(piParam->getControlName()) == wanted)
+			return piParam;
+	}
+	return nullptr;
+}
+
+/** list controls also take one of their strings; \return false if text is neither */
+static bool parseParameterValue(PluginParameter* piParam, const std::string& text, double& value)
+{
+	if (parseNumber(text, value))
+		return true;
+	if (piParam->getControlVariableType() != controlVariableType::kTypedEnumStringList)
+		return false;
+
+	std::string list = piParam->getCommaSeparatedStringList();
+	std::string wanted = normalizeName(text.c_str());
+	size_t start = 0;
+	for (uint32_t index = 0; start <= list.size(); index++)
+	{
+		size_t comma = list.find(',', start);
+		size_t end = comma == std::string::npos ? list.size() : comma;
+		if (normalizeName(list.substr(start, end - start).c_str()) == wanted)
+		{
+			value = index;
+			return true;
+		}
+		start = end + 1;
+	}
+	return false;
+}
+
+static void listControlsAndPresets(PluginCore& core)
+{
+	printf("controls (ID  name  [min, max] default units):\n");
+	for (uint32_t i = 0; i < core.getPluginParameterCount(); i++)
+	{
+		PluginParameter* piParam = core.getPluginParameterByIndex(i);
+		if (!piParam)
+			continue;
+		printf("  %-8u %-20s [%g, %g] %g %s\n", piParam->getControlID(), piParam->getControlName(),
+			piParam->getMinValue(), piParam->getMaxValue(), piParam->getDefaultValue(), piParam->getControlUnits());
+	}
+	printf("presets (factory, then bank):\n");
+	for (uint32_t i = 0; i < core.getPresetCount(); i++)
+		printf("  %s\n", core.getPresetName(i));
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& bytes)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+	uint8_t buffer[65536];
+	size_t read = 0;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& bytes)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	bool ok = bytes.empty() || fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	return fclose(file) == 0 && ok;
+}
+
+static int usage()
+{
+	fprintf(stderr, "usage: echoplex_render [--preset name] [--param control=value]... [--bank file.epbk]\n"
+		"                       [--block frames] [--tail seconds] [--bits 16|24|32]\n"
+		"                       [--load-state file] [--save-state file] input.wav output.wav\n"
+		"       echoplex_render [--bank file.epbk] --list\n");
+	return 2;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* inputPath = nullptr;
+	const char* outputPath = nullptr;
+	const char* presetName = nullptr;
+	const char* bankPath = nullptr;
+	const char* loadStatePath = nullptr;
+	const char* saveStatePath = nullptr;
+	std::vector<std::string> parameterSettings;
+	uint32_t blockSize = 512;
+	double tail_Sec = 0.0;
+	uint32_t outputBits = 32;
+	bool listOnly = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--list")
+			listOnly = true;
+		else if (arg == "--preset" && hasValue)
+			presetName = argv[++i];
+		else if (arg == "--param" && hasValue)
+			parameterSettings.push_back(argv[++i]);
+		else if (arg == "--bank" && hasValue)
+			bankPath = argv[++i];
+		else if (arg == "--block" && hasValue)
+			blockSize = (uint32_t)atoi(argv[++i]);
+		else if (arg == "--tail" && hasValue)
+			tail_Sec = atof(argv[++i]);
+		else if (arg == "--bits" && hasValue)
+			outputBits = (uint32_t)atoi(argv[++i]);
+		else if (arg == "--load-state" && hasValue)
+			loadStatePath = argv[++i];
+		else if (arg == "--save-state" && hasValue)
+			saveStatePath = argv[++i];
+		else if (arg.size() > 1 && arg[0] == '-')
+			return usage();
+		else if (!inputPath)
+			inputPath = argv[i];
+		else if (!outputPath)
+			outputPath = argv[i];
+		else
+			return usage();
+	}
+	if (!listOnly && (!inputPath || !outputPath))
+		return usage();
+	if (blockSize == 0 || tail_Sec < 0.0 || (outputBits != 16 && outputBits != 24 && outputBits != 32))
+		return usage();
+
+	// --- heap allocated, as every host does
+	std::unique_ptr<PluginCore> core(new PluginCore);
+	PluginInfo pluginInfo;
+	pluginInfo.pathToDLL = argv[0]; // --- picks up Echoplex.epbk next to the tool
+	core->initialize(pluginInfo);
+	if (bankPath)
+	{
+		if (!core->presetBank.open(bankPath))
+		{
+			fprintf(stderr, "echoplex_render: can't open preset bank %s\n", bankPath);
+			return 1;
+		}
+	}
+	if (listOnly)
+	{
+		listControlsAndPresets(*core);
+		return 0;
+	}
+
+	WavReader reader;
+	if (!reader.open(inputPath))
+	{
+		fprintf(stderr, "echoplex_render: %s: %s\n", inputPath, reader.getError().c_str());
+		return 1;
+	}
+	if (reader.getChannelCount() > 2)
+		fprintf(stderr, "echoplex_render: %s has %u channels; only the first two are used\n", inputPath, reader.getChannelCount());
+
+	// --- a session restore comes before reset(), which loads the held modulator and tape contents
+	if (loadStatePath)
+	{
+		std::vector<uint8_t> chunk;
+		if (!readFile(loadStatePath, chunk) || !core->setStateChunk(chunk.data(), chunk.size()))
+		{
+			fprintf(stderr, "echoplex_render: %s isn't a saved Echoplex state\n", loadStatePath);
+			return 1;
+		}
+	}
+
+	OfflineProcessor processor(*core, blockSize);
+	processor.reset(reader.getSampleRate(), reader.getBitDepth());
+
+	// --- settings go in after reset(): jumped to, no smoothing, synced at the top of the first buffer
+	if (presetName && !core->applyPresetByName(presetName))
+	{
+		fprintf(stderr, "echoplex_render: no preset named \"%s\" (try --list)\n", presetName);
+		return 1;
+	}
+	for (const std::string& setting : parameterSettings)
+	{
+		size_t equals = setting.rfind('=');
+		PluginParameter* piParam = equals == std::string::npos ? nullptr : findParameter(*core, setting.substr(0, equals));
+		double value = 0.0;
+		if (!piParam || !parseParameterValue(piParam, setting.substr(equals + 1), value))
+		{
+			fprintf(stderr, "echoplex_render: bad --param \"%s\" (try --list)\n", setting.c_str());
+			return 1;
+		}
+		if (value < piParam->getMinValue() || value > piParam->getMaxValue())
+		{
+			value = value < piParam->getMinValue() ? piParam->getMinValue() : piParam->getMaxValue();
+			fprintf(stderr, "echoplex_render: %s clamped to %g\n", piParam->getControlName(), value);
+		}
+		piParam->setControlValue(value);		// --- the smoothing target, or smoothing glides back to the default
+		piParam->setControlValue(value, true);
+		core->storeControlValue(piParam->getControlID(), piParam);
+	}
+
+	WavWriter writer;
+	if (!writer.open(outputPath, 2, reader.getSampleRate(), outputBits))
+	{
+		fprintf(stderr, "echoplex_render: can't write %s\n", outputPath);
+		return 1;
+	}
+
+	// --- the file's channels; the processor holds the plugin's stereo in/out
+	uint32_t fileChannels = reader.getChannelCount();
+	std::vector<float> fileStorage((size_t)fileChannels * blockSize);
+	std::vector<float*> fileBuffers(fileChannels);
+	for (uint32_t channel = 0; channel < fileChannels; channel++)
+		fileBuffers[channel] = &fileStorage[(size_t)channel * blockSize];
+	float** inputs = processor.getInputs();
+
+	uint64_t tailFrames = (uint64_t)(tail_Sec * reader.getSampleRate() + 0.5);
+	std::chrono::steady_clock::duration processTime(0);
+	for (;;)
+	{
+		uint32_t frames = reader.read(fileBuffers.data(), blockSize);
+		if (frames > 0)
+		{
+			memcpy(inputs[0], fileBuffers[0], frames * sizeof(float));
+			memcpy(inputs[1], fileBuffers[fileChannels > 1 ? 1 : 0], frames * sizeof(float));
+		}
+		else
+		{
+			frames = tailFrames < blockSize ? (uint32_t)tailFrames : blockSize;
+			if (frames == 0)
+				break;
+			tailFrames -= frames;
+			memset(inputs[0], 0, frames * sizeof(float));
+			memset(inputs[1], 0, frames * sizeof(float));
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		processor.process(frames);
+		processTime += std::chrono::steady_clock::now() - start;
+
+		if (!writer.write(processor.getOutputs(), frames))
+		{
+			fprintf(stderr, "echoplex_render: write to %s failed\n", outputPath);
+			return 1;
+		}
+	}
+	if (!writer.close())
+	{
+		fprintf(stderr, "echoplex_render: write to %s failed\n", outputPath);
+		return 1;
+	}
+
+	if (saveStatePath)
+	{
+		std::vector<uint8_t> chunk;
+		core->getStateChunk(chunk, true, true);
+		if (!writeFile(saveStatePath, chunk))
+		{
+			fprintf(stderr, "echoplex_render: can't write %s\n", saveStatePath);
+			return 1;
+		}
+	}
+
+	double audio_Sec = (double)processor.getFramesProcessed() / reader.getSampleRate();
+	double process_Sec = std::chrono::duration<double>(processTime).count();
+	printf("%s: %.3f s of audio at %u Hz in %.3f s processing = %.1fx realtime\n", outputPath,
+		audio_Sec, reader.getSampleRate(), process_Sec, process_Sec > 0.0 ? audio_Sec / process_Sec : 0.0);
+	return 0;
+}
@@ -0,0 +1,198 @@
+// -----------------------------------------------------------------------------
+//    Echoplex real-time safety check:  echoplex_rtcheck.cpp
+//
+/**
+    \file   echoplex_rtcheck.cpp
+    \brief  runs PluginCore's audio path inside a RealtimeScope (see RealtimeSafety.h) and
+    		fails, with a stack trace, on the first allocation, lock, sleep or file/mapping
+    		syscall it makes
+
+    echoplex_rtcheck [options]
+
+    	--rates <r,r,...>		sample rates (default 44100,48000,96000)
+    	--blocks <n,n,...>		block sizes (default 1,64,512,4096)
+    	--seconds <s>			audio per scenario (default 1)
+    	--keep-going			count violations instead of aborting on the first
+
+    For each rate and block size, three scenarios; set-up (initialize, reset, preset loads)
+    runs outside the scope, as it does on a host's main thread:
+    	steady			the default patch
+    	automation		every control moved by the host each block (updatePluginParameterNormalized
+    					on the audio thread, as VST3 and AU do), Preset Morph included
+    	presets			each factory preset, loaded between runs
+
+    Exit status: 0 clean, 1 violations (with --keep-going), abort() otherwise; 77 where
+    the checker isn't supported (not glibc).
+*/
+// -----------------------------------------------------------------------------
+#include "PluginCore.h"
+#include "OfflineProcessor.h"
+#include "RealtimeSafety.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** comma separated numbers */
+static std::vector<double> parseList(const char* text)
+{
+	std::vector<double> values;
+	for (const char* p = text; *p;)
+	{
+		char* end = nullptr;
+		double value = strtod(p, &end);
+		if (end == p)
+			break;
+		values.push_back(value);
+		p = *end == ',' ? end + 1 : end;
+	}
+	return values;
+}
+
+/** a fresh instance, set up the way a host does before it starts streaming */
+static std::unique_ptr<PluginCore> createCore()
+{
+	std::unique_ptr<PluginCore> core(new PluginCore);
+	PluginInfo pluginInfo;
+	core->initialize(pluginInfo);
+	return core;
+}
+
+/** non-silent stereo input, so nothing in the chain can skip work */
+static void fillInputs(OfflineProcessor& processor, uint32_t blockSize, double sampleRate)
+{
+	for (uint32_t i = 0; i < blockSize; i++)
+	{
+		double x = 0.5 * sin(2.0 * 3.14159265358979 * 440.0 * i / sampleRate);
+		processor.getInputs()[0][i] = (float)x;
+		processor.getInputs()[1][i] = (float)-x;
+	}
+}
+
+/** numBlocks blocks of audio, each one inside the scope */
+static void runBlocks(OfflineProcessor& processor, uint32_t blockSize, uint64_t numBlocks)
+{
+	for (uint64_t block = 0; block < numBlocks; block++)
+	{
+		RealtimeScope scope("processAudioBuffers");
+		processor.process(blockSize);
+	}
+}
+
+static void runSteady(double sampleRate, uint32_t blockSize, uint64_t numBlocks)
+{
+	std::unique_ptr<PluginCore> core = createCore();
+	OfflineProcessor processor(*core, blockSize);
+	processor.reset(sampleRate);
+	fillInputs(processor, blockSize, sampleRate);
+	runBlocks(processor, blockSize, numBlocks);
+}
+
+static void runAutomation(double sampleRate, uint32_t blockSize, uint64_t numBlocks)
+{
+	std::unique_ptr<PluginCore> core = createCore();
+	OfflineProcessor processor(*core, blockSize);
+	processor.reset(sampleRate);
+	fillInputs(processor, blockSize, sampleRate);
+	if (core->getPresetCount() >= 2)
+		core->loadMorphPresets(0, 1);
+
+	std::vector<int32_t> controlIDs;
+	for (uint32_t i = 0; i < core->getPluginParameterCount(); i++)
+		controlIDs.push_back((int32_t)core->getPluginParameterByIndex(i)->getControlID());
+
+	for (uint64_t block = 0; block < numBlocks; block++)
+	{
+		RealtimeScope scope("automation + processAudioBuffers");
+		for (size_t i = 0; i < controlIDs.size(); i++)
+		{
+			// --- a slow sweep per control, out of step with each other
+			double normalized = 0.5 + 0.5 * sin(0.01 * (double)block * (1.0 + 0.37 * (double)i));
+			ParameterUpdateInfo paramInfo;
+			paramInfo.bufferProcUpdate = true;
+			core->updatePluginParameterNormalized(controlIDs[i], normalized, paramInfo);
+		}
+		processor.process(blockSize);
+	}
+}
+
+static void runPresets(double sampleRate, uint32_t blockSize, uint64_t numBlocks)
+{
+	std::unique_ptr<PluginCore> core = createCore();
+	OfflineProcessor processor(*core, blockSize);
+	processor.reset(sampleRate);
+	fillInputs(processor, blockSize, sampleRate);
+
+	uint32_t numPresets = (uint32_t)core->getPresetCount();
+	for (uint32_t preset = 0; preset < numPresets; preset++)
+	{
+		core->applyPresetByName(core->getPresetName(preset));
+		runBlocks(processor, blockSize, numBlocks / (numPresets ? numPresets : 1) + 1);
+	}
+}
+
+static int usage()
+{
+	fprintf(stderr, "usage: echoplex_rtcheck [--rates r,r] [--blocks n,n] [--seconds s] [--keep-going]\n");
+	return 2;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<double> sampleRates = { 44100.0, 48000.0, 96000.0 };
+	std::vector<double> blockSizes = { 1.0, 64.0, 512.0, 4096.0 };
+	double seconds = 1.0;
+	bool keepGoing = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--keep-going")
+			keepGoing = true;
+		else if (arg == "--rates" && hasValue)
+			sampleRates = parseList(argv[++i]);
+		else if (arg == "--blocks" && hasValue)
+			blockSizes = parseList(argv[++i]);
+		else if (arg == "--seconds" && hasValue)
+			seconds = atof(argv[++i]);
+		else
+			return usage();
+	}
+	if (sampleRates.empty() || blockSizes.empty() || seconds <= 0.0)
+		return usage();
+
+	if (!RealtimeSafety::isSupported())
+	{
+		fprintf(stderr, "echoplex_rtcheck: interposition needs glibc; nothing checked\n");
+		return 77;
+	}
+	RealtimeSafety::setAbortOnViolation(!keepGoing);
+
+	for (double sampleRate : sampleRates)
+	{
+		for (double blockSizeValue : blockSizes)
+		{
+			uint32_t blockSize = blockSizeValue < 1.0 ? 1 : (uint32_t)blockSizeValue;
+			uint64_t numBlocks = (uint64_t)ceil(seconds * sampleRate / blockSize);
+			fprintf(stderr, "%6.0f Hz, block %4u: steady", sampleRate, blockSize);
+			runSteady(sampleRate, blockSize, numBlocks);
+			fprintf(stderr, ", automation");
+			runAutomation(sampleRate, blockSize, numBlocks);
+			fprintf(stderr, ", presets\n");
+			runPresets(sampleRate, blockSize, numBlocks);
+		}
+	}
+
+	uint64_t violations = RealtimeSafety::getViolationCount();
+	if (violations)
+	{
+		fprintf(stderr, "echoplex_rtcheck: %llu realtime violation(s)\n", (unsigned long long)violations);
+		return 1;
+	}
+	fprintf(stderr, "echoplex_rtcheck: audio path is clean\n");
+	return 0;
+}
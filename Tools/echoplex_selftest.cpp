@@ -0,0 +1,679 @@
+// -----------------------------------------------------------------------------
+//    Echoplex self tests:  echoplex_selftest.cpp
+//
+/**
+    \file   echoplex_selftest.cpp
+    \brief  checks that need real numbers rather than a compiler, one named case per
+    		CTest test (see CMakeLists.txt)
+
+    echoplex_selftest [case ...]		run the named cases (default: all)
+    echoplex_selftest --list			print the case names
+
+    Exit status: 0 when every case passes, 1 otherwise.
+*/
+// -----------------------------------------------------------------------------
+#include "PluginCore.h"
+#include "NoiseLoopTable.h"
+#include "PresetBank.h"
+#include "OfflineProcessor.h"
+#include "TapeEchoDelay.h"
+#include "ScaledBitmapCache.h"
+#include "UIDescriptionCache.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** one check: prints what it measured, returns false on failure */
+struct SelfTest
+{
+	const char* name;
+	bool(*run)();
+};
+
+/**
+two readers of one drift noise table must not audibly repeat each other: the largest cross
+correlation over +/-10 mSec of lag stays within a few times chance level (0.1 for 1 second of
+50 Hz noise), and the loop itself reads back at r = 1 one table length later
+*/
+static bool testNoiseLoopDecorrelation()
+{
+	const double sampleRate = 48000.0;
+	const double chanceLevel = 0.1;
+	const double maxCorrelation = 3.0 * chanceLevel;
+	NoiseLoopTable table(sampleRate, 50.0, NoiseColour::gaussian, 6.0, 0x2545F491u);
+
+	uint32_t numSamples = (uint32_t)sampleRate;
+	uint32_t maxLag = (uint32_t)(0.01 * sampleRate);
+	bool passed = true;
+	const uint32_t offsets[][2] = { { 0, 48000 }, { 1000, 150000 }, { 77777, 200003 }, { 0, table.getLength() / 2 } };
+	for (const auto& offset : offsets)
+	{
+		double r = table.measureMaxCorrelation(offset[0], offset[1], numSamples, maxLag);
+		printf("  readers at %6u and %6u: max |r| = %.3f (limit %.2f)\n", offset[0], offset[1], r, maxCorrelation);
+		passed = passed && r < maxCorrelation;
+	}
+
+	double loop = table.measureMaxCorrelation(0, table.getLength(), numSamples, 0);
+	printf("  loop wrap: r = %.3f (expect 1)\n", loop);
+	return passed && loop > 0.999;
+}
+
+/**
+every parameter PluginCore registers has a dense slot that maps back to it, except the ones that
+are allowed none (Scale GUI and the outbound meters), and every slot has a parameter; unmapped
+IDs read safely through getControlValue()
+*/
+static bool testDenseControls()
+{
+	PluginCore core;
+	bool passed = true;
+	uint32_t mapped = 0;
+	for (uint32_t i = 0; i < core.getPluginParameterCount(); i++)
+	{
+		PluginParameter* parameter = core.getPluginParameterByIndex(i);
+		int32_t id = (int32_t)parameter->getControlID();
+		int32_t slot = getDenseControlSlot(id);
+		bool exempt = parameter->getControlID() == SCALE_GUI_SIZE || parameter->getControlVariableType() == controlVariableType::kMeter;
+		if (slot < 0)
+		{
+			if (!exempt)
+			{
+				printf("  controlID %d (%s) has no dense slot: add it to kDenseControlIDs\n", id, parameter->getControlName());
+				passed = false;
+			}
+			continue;
+		}
+		if (core.denseControlParameters[slot] != parameter || core.getControlParameter(id) != parameter)
+		{
+			printf("  controlID %d (%s): slot %d doesn't map back to it\n", id, parameter->getControlName(), slot);
+			passed = false;
+		}
+		mapped++;
+	}
+	for (uint32_t slot = 0; slot < kNumDenseControls; slot++)
+	{
+		if (!core.denseControlParameters[slot])
+		{
+			printf("  kDenseControlIDs[%u] = %d is never registered\n", slot, kDenseControlIDs[slot]);
+			passed = false;
+		}
+	}
+	printf("  %u of %u parameters mapped to %u slots\n", mapped, (uint32_t)core.getPluginParameterCount(), kNumDenseControls);
+
+	// --- no slot, no parameter: must not index the packed arrays
+	double unmapped = core.getControlValue(kMaxDenseControlID + 1000);
+	double scaleGUI = core.getControlValue((int32_t)SCALE_GUI_SIZE);
+	printf("  unmapped controlID reads %g, Scale GUI reads %g\n", unmapped, scaleGUI);
+	return passed && mapped == kNumDenseControls && unmapped == 0.0;
+}
+
+/**
+a value written straight into a parameter with setPIParamValue() (the way the API shells' state
+and preset restores write) is flagged like any other write and reaches the bound variable and its
+cooked form at the top of the next buffer, now that nothing compares every control per buffer
+*/
+static bool testUnflaggedWrites()
+{
+	PluginCore core;
+	PluginInfo pluginInfo;
+	core.initialize(pluginInfo);
+	OfflineProcessor processor(core, 64);
+	processor.reset(48000.0);
+	processor.process(64);
+
+	const double noiseLevel = -42.0;
+	core.setPIParamValue(controlID::noiseLevel_dB, noiseLevel);
+	processor.process(64);
+
+	double synced = core.getControlValue(controlID::noiseLevel_dB);
+	double expected = pow(10.0, noiseLevel / 20.0);
+	printf("  Noise Level set to %g dB directly: synced %g dB, cooked %g (expect %g)\n", noiseLevel, synced, core.noiseLevel_cooked, expected);
+
+	// --- a smoothed control records where its glide ended without being flagged again
+	ParameterUpdateInfo paramInfo;
+	core.updatePluginParameter(controlID::delayTime_ms, 600.0, paramInfo);
+	for (int i = 0; i < 48000 / 4 / 64; i++)
+		processor.process(64);
+	double delaySynced = core.getControlValue(controlID::delayTime_ms);
+	printf("  Delay Time glided to 600 ms: synced %g ms\n", delaySynced);
+	return synced == noiseLevel && fabs(core.noiseLevel_cooked - expected) < 1.0e-12 && delaySynced == 600.0;
+}
+
+/** the slots the editor would redraw on a timer ping now */
+static std::vector<uint32_t> pingChangedControls(PluginCore& core)
+{
+	std::vector<uint32_t> slots;
+	core.guiChangeTracker.syncChanged([&slots](uint32_t slot) { slots.push_back(slot); });
+	return slots;
+}
+
+static bool pingReports(PluginCore& core, int32_t id, const char* what)
+{
+	std::vector<uint32_t> slots = pingChangedControls(core);
+	bool reported = false;
+	for (uint32_t slot : slots)
+		reported |= kDenseControlIDs[slot] == id;
+	printf("  %-44s %u control(s) to redraw, %s %s\n", what, (uint32_t)slots.size(), core.getControlParameter(id)->getControlName(),
+		reported ? "among them" : "MISSING");
+	return reported;
+}
+
+/**
+the editor hears about every way a control's value changes: a direct setPIParamValue() write
+and each buffer of a smoothing glide; a
+change to a control without a dense slot asks for one full resync
+*/
+static bool testGUIChangeTracking()
+{
+	PluginCore core;
+	PluginInfo pluginInfo;
+	core.initialize(pluginInfo);
+	OfflineProcessor processor(core, 64);
+	processor.reset(48000.0);
+	processor.process(64);
+	core.guiChangeTracker.markAllSynced();
+
+	core.setPIParamValue(controlID::noiseLevel_dB, -42.0);
+	processor.process(64);
+	bool unflagged = pingReports(core, controlID::noiseLevel_dB, "direct write:");
+
+	ParameterUpdateInfo paramInfo;
+	core.updatePluginParameter(controlID::delayTime_ms, 600.0, paramInfo);
+	processor.process(64);
+	pingChangedControls(core);
+	processor.process(64);
+	bool gliding = pingReports(core, controlID::delayTime_ms, "smoothing glide, a buffer later:");
+
+	core.storeControlValue(SCALE_GUI_SIZE, core.getPluginParameterByControlID(SCALE_GUI_SIZE));
+	bool fullSync = core.guiChangeTracker.takeFullSync();
+	bool onlyOnce = !core.guiChangeTracker.takeFullSync();
+	printf("  %-44s full resync %s%s\n", "Scale GUI (no dense slot) changed:", fullSync ? "requested" : "MISSING", onlyOnce ? ", once" : ", REPEATED");
+	return unflagged && gliding && fullSync && onlyOnce;
+}
+
+/** run frames through the processor in 64 frame buffers */
+static void processFrames(OfflineProcessor& processor, uint32_t frames)
+{
+	for (uint32_t done = 0; done < frames; done += 64)
+		processor.process(64);
+}
+
+/** a control's parameter value and its last synced value both equal expected */
+static bool controlSettled(PluginCore& core, int32_t id, double expected, const char* what)
+{
+	double value = core.getControlParameter(id)->getControlValue();
+	double synced = core.getControlValue(id);
+	bool settled = fabs(value - expected) < 1.0e-6 && fabs(synced - expected) < 1.0e-6;
+	printf("  %-44s %-16s %10.4f synced %10.4f (expect %.4f)%s\n", what, core.getControlParameter(id)->getControlName(),
+		value, synced, expected, settled ? "" : "  <--");
+	return settled;
+}
+
+/**
+the Morph control: a move lands every smoothed control on the morphed value and it stays there;
+new morph presets apply with the knob at rest; a state restore's values aren't overwritten by
+re-running the morph at the restored Morph position
+*/
+static bool testPresetMorph()
+{
+	PluginCore core;
+	PluginInfo pluginInfo;
+	core.initialize(pluginInfo);
+	OfflineProcessor processor(core, 64);
+	processor.reset(48000.0);
+	processFrames(processor, 4800);
+
+	PresetInfo* presetA = core.getPreset(0);
+	PresetInfo* presetB = core.getPreset(1);
+	auto presetValue = [](PresetInfo* preset, int32_t id) {
+		for (PresetParameter& parameter : preset->presetParameters)
+			if ((int32_t)parameter.controlID == id) return parameter.actualValue;
+		return 0.0;
+	};
+
+	// --- Morph to B: smoothed and unsmoothed controls arrive and stay
+	ParameterUpdateInfo paramInfo;
+	core.updatePluginParameter(controlID::presetMorph, 1.0, paramInfo);
+	processFrames(processor, 48000);
+	bool passed = controlSettled(core, controlID::delayTime_ms, presetValue(presetB, controlID::delayTime_ms), "Morph to B, 1 s later:");
+	passed = controlSettled(core, controlID::feedBack_pct, presetValue(presetB, controlID::feedBack_pct), "") && passed;
+	passed = controlSettled(core, controlID::noiseLevel_dB, presetValue(presetB, controlID::noiseLevel_dB), "") && passed;
+	processFrames(processor, 24000);
+	passed = controlSettled(core, controlID::delayTime_ms, presetValue(presetB, controlID::delayTime_ms), "0.5 s more, no glide back:") && passed;
+
+	// --- swap the presets with Morph at rest (1.0): now it means A
+	core.loadMorphPresets(1, 0);
+	processFrames(processor, 48000);
+	passed = controlSettled(core, controlID::delayTime_ms, presetValue(presetA, controlID::delayTime_ms), "presets swapped, knob at rest:") && passed;
+
+	// --- save with Morph at 1 and a hand-set Noise Level, move Morph, restore: the saved values win
+	core.updatePluginParameter(controlID::noiseLevel_dB, -20.0, paramInfo);
+	processFrames(processor, 4800);
+	std::vector<uint8_t> chunk;
+	core.getStateChunk(chunk, false, false);
+	core.updatePluginParameter(controlID::presetMorph, 0.5, paramInfo);
+	processFrames(processor, 48000);
+	core.setStateChunk(chunk.data(), chunk.size());
+	processFrames(processor, 48000);
+	passed = controlSettled(core, controlID::noiseLevel_dB, -20.0, "restored over Morph 0.5 -> 1:") && passed;
+	passed = controlSettled(core, controlID::presetMorph, 1.0, "") && passed;
+	return passed;
+}
+
+static bool writeImage(const char* path, const std::vector<uint8_t>& image)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(&image[0], 1, image.size(), file) == image.size();
+	return fclose(file) == 0 && ok;
+}
+
+/**
+rewrite one index entry of a two preset bank image on disk; the bank still opens (entries are
+only checked when read) but never hands the corrupt entry out, and the other one still loads
+*/
+static bool bankSkipsEntry(const char* path, std::vector<uint8_t> image, uint32_t entry, uint32_t presetNumber, uint32_t nameOffset)
+{
+	PresetBank::BankHeader header;
+	memcpy(&header, &image[0], sizeof(header));
+	PresetBank::BankIndexEntry* index = (PresetBank::BankIndexEntry*)&image[(size_t)header.indexOffset];
+	index[entry].presetNumber = presetNumber;
+	index[entry].nameOffset = nameOffset;
+	if (!writeImage(path, image))
+		return false;
+
+	PresetBank bank;
+	if (!bank.open(path))
+		return false;
+	uint32_t row = 0;
+	const char* otherName = bank.getPresetName(1 - entry, row);
+	return bank.getPresetName(entry, row) == nullptr && otherName && bank.find(otherName) == (int32_t)row;
+}
+
+/**
+a bank next to the plugin binary shows up in the host's preset list and loads from there and by
+name, landing on its values without gliding back; index entries that point outside the file are
+never served, and a bank whose header doesn't match the file is refused
+*/
+static bool testPresetBank()
+{
+	const char* bankPath = "Echoplex.epbk";
+	const double delayTime = 777.0;
+	const double noiseLevel = -33.0;
+	std::vector<int32_t> bankControlIDs(kDenseControlIDs, kDenseControlIDs + kNumDenseControls);
+	std::vector<std::string> presetNames = { "Bank Test", "Bank Test 2" };
+	std::vector<double> presetValues;
+	{
+		PluginCore defaults;
+		for (uint32_t preset = 0; preset < presetNames.size(); preset++)
+		{
+			for (int32_t id : bankControlIDs)
+			{
+				double value = defaults.getControlParameter(id)->getDefaultValue();
+				value = id == controlID::delayTime_ms ? delayTime : id == controlID::noiseLevel_dB ? noiseLevel : value;
+				presetValues.push_back(value);
+			}
+		}
+	}
+	if (!PresetBank::writeBank(bankPath, bankControlIDs, presetNames, presetValues))
+	{
+		printf("  can't write %s\n", bankPath);
+		return false;
+	}
+
+	PluginCore core;
+	PluginInfo pluginInfo;
+	pluginInfo.pathToDLL = "./echoplex_selftest";
+	core.initialize(pluginInfo);
+	OfflineProcessor processor(core, 64);
+	processor.reset(48000.0);
+	processFrames(processor, 4800);
+
+	PresetInfo* published = nullptr;
+	for (uint32_t i = 0; i < core.getPresetCount(); i++)
+		if (core.getPreset(i)->presetName == "Bank Test") published = core.getPreset(i);
+	printf("  host preset list: %u presets, bank preset %s\n", (uint32_t)core.getPresetCount(), published ? "listed" : "MISSING");
+	bool passed = published != nullptr;
+
+	passed = core.applyPresetByName("Bank Test 2") && passed;
+	processFrames(processor, 64);
+	passed = controlSettled(core, controlID::delayTime_ms, delayTime, "bank preset loaded, next buffer:") && passed;
+	processFrames(processor, 48000);
+	passed = controlSettled(core, controlID::delayTime_ms, delayTime, "1 s later, no glide back:") && passed;
+	passed = controlSettled(core, controlID::noiseLevel_dB, noiseLevel, "") && passed;
+
+	// --- corrupt index entries: a row past the end, a name past the end of the file
+	std::vector<uint8_t> image;
+	FILE* file = fopen(bankPath, "rb");
+	if (file)
+	{
+		uint8_t buffer[4096];
+		size_t read = 0;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			image.insert(image.end(), buffer, buffer + read);
+		fclose(file);
+	}
+	bool rejectsRow = !image.empty() && bankSkipsEntry(bankPath, image, 1, 2, 0);
+	bool rejectsName = !image.empty() && bankSkipsEntry(bankPath, image, 0, 0, 0x7FFFFFFF);
+	printf("  index entry with row 2 of 2: %s, name offset past the file: %s\n", rejectsRow ? "skipped" : "SERVED",
+		rejectsName ? "skipped" : "SERVED");
+
+	// --- a truncated file no longer matches its header's size
+	bool rejectsTruncated = false;
+	if (!image.empty())
+	{
+		image.resize(image.size() / 2);
+		PresetBank bank;
+		rejectsTruncated = writeImage(bankPath, image) && !bank.open(bankPath);
+	}
+	printf("  truncated bank: %s\n", rejectsTruncated ? "refused" : "ACCEPTED");
+	remove(bankPath);
+	return passed && rejectsRow && rejectsName && rejectsTruncated;
+}
+
+/**
+a session restored into a fresh instance saves back byte for byte: parameters, modulator
+positions, the comb's memory and the tape
+*/
+static bool testStateChunk()
+{
+	PluginCore core;
+	PluginInfo pluginInfo;
+	core.initialize(pluginInfo);
+	OfflineProcessor processor(core, 64);
+	processor.reset(48000.0);
+	ParameterUpdateInfo paramInfo;
+	core.updatePluginParameter(controlID::delayTime_ms, 321.0, paramInfo);
+	core.updatePluginParameter(controlID::noiseLevel_dB, -27.0, paramInfo);
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		processor.getInputs()[0][i] = (float)(0.5 * sin(2.0 * 3.14159265358979 * 440.0 * i / 48000.0));
+		processor.getInputs()[1][i] = processor.getInputs()[0][i];
+	}
+	processFrames(processor, 48000);
+
+	std::vector<uint8_t> saved;
+	core.getStateChunk(saved, true, true);
+
+	PluginCore restored;
+	restored.initialize(pluginInfo);
+	bool accepted = restored.setStateChunk(saved.data(), saved.size());
+	OfflineProcessor restoredProcessor(restored, 64);
+	restoredProcessor.reset(48000.0);
+	std::vector<uint8_t> resaved;
+	restored.getStateChunk(resaved, true, true);
+
+	size_t firstDifference = 0;
+	while (firstDifference < saved.size() && firstDifference < resaved.size() && saved[firstDifference] == resaved[firstDifference])
+		firstDifference++;
+	bool identical = saved.size() == resaved.size() && firstDifference == saved.size();
+	printf("  %zu byte chunk, restored and saved again: %s", saved.size(), identical ? "identical\n" : "DIFFERS");
+	if (!identical)
+		printf(" at byte %zu\n", firstDifference);
+
+	// --- the tape is in it: one second, and the input is the same on both tracks so one track is stored
+	std::vector<uint8_t> withoutTape;
+	core.getStateChunk(withoutTape, true, false);
+	size_t tapeBytes = saved.size() - withoutTape.size();
+	bool tapeStored = tapeBytes >= 48000 * sizeof(float) && tapeBytes < 48000 * 2 * sizeof(float);
+	printf("  tape section: %zu bytes (expect one track, %zu)\n", tapeBytes, 48000 * sizeof(float));
+
+	// --- different tracks go in interleaved and come back the same
+	for (uint32_t i = 0; i < 64; i++)
+		processor.getInputs()[1][i] = -processor.getInputs()[0][i];
+	processFrames(processor, 4800);
+	std::vector<uint8_t> stereo;
+	core.getStateChunk(stereo, true, true);
+	PluginCore stereoRestored;
+	stereoRestored.initialize(pluginInfo);
+	stereoRestored.setStateChunk(stereo.data(), stereo.size());
+	OfflineProcessor stereoProcessor(stereoRestored, 64);
+	stereoProcessor.reset(48000.0);
+	std::vector<uint8_t> stereoResaved;
+	stereoRestored.getStateChunk(stereoResaved, true, true);
+	bool stereoIdentical = stereo == stereoResaved && stereo.size() > saved.size() + 48000 * sizeof(float);
+	printf("  %zu byte chunk with different tracks, restored and saved again: %s\n", stereo.size(), stereoIdentical ? "identical" : "DIFFERS");
+
+	// --- an LFO stopped just past its wrap restores to the same phase (the render wraps before it advances)
+	LFO_Ex lfo;
+	LFO_ExParameters lfoParams = lfo.getParameters();
+	lfoParams.frequency_Hz = 4800.0;
+	lfo.setParameters(lfoParams);
+	lfo.reset(48000.0);
+	lfo.setPhase(0.95);
+	lfo.renderAudioOutput();
+	LFO_Ex restoredLFO;
+	restoredLFO.setParameters(lfoParams);
+	restoredLFO.reset(48000.0);
+	double savedPhase = lfo.getPhase();
+	restoredLFO.setPhase(savedPhase);
+	bool phaseRestored = restoredLFO.getPhase() == savedPhase && savedPhase < 1.0 &&
+		restoredLFO.renderAudioOutput().normalOutput == lfo.renderAudioOutput().normalOutput;
+	printf("  LFO phase at the wrap: %.17g, restored %s\n", savedPhase, phaseRestored ? "the same" : "DIFFERENT");
+
+	// --- truncated chunks are refused
+	bool truncatedRefused = !restored.setStateChunk(saved.data(), saved.size() / 2);
+	printf("  truncated chunk: %s\n", truncatedRefused ? "refused" : "ACCEPTED");
+	return accepted && identical && tapeStored && stereoIdentical && phaseRestored && truncatedRefused;
+}
+
+/** send the GUI a message, the way the kernel's GUI connector does */
+static void sendGUIMessage(PluginCore& core, uint32_t message)
+{
+	MessageInfo messageInfo;
+	messageInfo.message = message;
+	core.processMessage(messageInfo);
+}
+
+/** fill both inputs with a 440 Hz sine */
+static void setSineInput(OfflineProcessor& processor, double amplitude, uint32_t frames, double sampleRate)
+{
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		processor.getInputs()[0][i] = (float)(amplitude * sin(2.0 * 3.14159265358979 * 440.0 * i / sampleRate));
+		processor.getInputs()[1][i] = processor.getInputs()[0][i];
+	}
+}
+
+/**
+the telemetry meters: a timer ping shows the output peaks queued since the last one, and
+blocks queued while the editor was closed are dropped when it opens rather than shown as
+the first ping's peaks
+*/
+static bool testTelemetryMeters()
+{
+	PluginCore core;
+	PluginInfo pluginInfo;
+	core.initialize(pluginInfo);
+	OfflineProcessor processor(core, 64);
+	processor.reset(48000.0);
+	sendGUIMessage(core, PLUGINGUI_DIDOPEN);
+
+	setSineInput(processor, 0.5, 64, 48000.0);
+	processFrames(processor, 4800);
+	sendGUIMessage(core, PLUGINGUI_TIMERPING);
+	double peakL = core.getControlParameter(controlID::outputPeakL)->getControlValue();
+	double peakR = core.getControlParameter(controlID::outputPeakR)->getControlValue();
+	double wow = core.getControlParameter(controlID::tapeWow)->getControlValue();
+	bool live = peakL > 0.25 && peakR > 0.25 && wow >= 0.0 && wow <= 1.0;
+	printf("  editor open:   Out L %.4f  Out R %.4f  Tape Wow %.4f%s\n", peakL, peakR, wow, live ? "" : "  <--");
+
+	// --- editor closed: nothing drains, then it opens again before the first ping
+	sendGUIMessage(core, PLUGINGUI_WILLCLOSE);
+	processFrames(processor, 4800);
+	sendGUIMessage(core, PLUGINGUI_DIDOPEN);
+	sendGUIMessage(core, PLUGINGUI_TIMERPING);
+	peakL = core.getControlParameter(controlID::outputPeakL)->getControlValue();
+	peakR = core.getControlParameter(controlID::outputPeakR)->getControlValue();
+	bool fresh = peakL == 0.0 && peakR == 0.0;
+	printf("  editor reopened, first ping: Out L %.4f  Out R %.4f (expect 0)%s\n", peakL, peakR, fresh ? "" : "  <--");
+	return live && fresh;
+}
+
+/** frame at which a channel of an impulse response peaks */
+static uint32_t findPeak(const std::vector<float>& response, uint32_t channel)
+{
+	uint32_t peak = 0;
+	for (uint32_t n = 0; n < response.size() / 2; n++)
+	{
+		if (fabs(response[2 * n + channel]) > fabs(response[2 * peak + channel]))
+			peak = n;
+	}
+	return peak;
+}
+
+/**
+with every interpolator an impulse recorded on the tape plays back at each channel's delay:
+the linked read (equal delays, what the plugin uses) and the unlinked fallback
+*/
+static bool testTapeEcho()
+{
+	const double sampleRate = 48000.0;
+	const char* interpolationNames[] = { "linear", "hermite", "lagrange4", "lagrange6", "thiran", "windowed sinc" };
+	const double delays[][2] = { { 10.0, 10.0 }, { 10.0, 15.5 } };
+	bool passed = true;
+	for (uint32_t interpolation = 0; interpolation <= (uint32_t)TapeInterpolation::windowedSinc; interpolation++)
+	{
+		for (const auto& delay : delays)
+		{
+			TapeEchoDelay tape;
+			tape.createDelayBuffers(sampleRate, 100.0);
+			tape.reset(sampleRate);
+			TapeEchoDelayParameters params = tape.getParameters();
+			params.interpolation = (TapeInterpolation)interpolation;
+			params.leftDelay_mSec = delay[0];
+			params.rightDelay_mSec = delay[1];
+			params.wetLevel_dB = 0.0;
+			params.dryLevel_dB = -200.0;
+			tape.setParameters(params);
+
+			std::vector<float> response(2 * 2048, 0.f);
+			for (uint32_t n = 0; n < 2048; n++)
+			{
+				float input[2] = { n == 0 ? 1.f : 0.f, n == 0 ? 1.f : 0.f };
+				tape.processAudioFrame(input, &response[2 * n], 2, 2);
+			}
+			uint32_t peakL = findPeak(response, 0);
+			uint32_t peakR = findPeak(response, 1);
+			uint32_t expectL = (uint32_t)(delay[0] * sampleRate / 1000.0);
+			uint32_t expectR = (uint32_t)(delay[1] * sampleRate / 1000.0);
+			bool ok = peakL == expectL && peakR == expectR;
+			printf("  %-13s delays %4.1f/%4.1f mSec: echoes at %u/%u (expect %u/%u)%s\n", interpolationNames[interpolation],
+				delay[0], delay[1], peakL, peakR, expectL, expectR, ok ? "" : "  FAILED");
+			passed = passed && ok;
+		}
+	}
+	return passed;
+}
+
+/**
+the Scale GUI cache renders only what is asked for: the source is read once per bitmap, each
+scale is posted once, nothing is found before its job runs, and a filmstrip is a separate
+entry from the same bitmap used whole; the plugin's poster (the editor cache's worker) renders too
+*/
+static bool testScaledBitmaps()
+{
+	const uint32_t kSmall = 1, kLarge = 4; // --- 0.75 and 1.15
+	uint32_t reads = 0;
+	auto readSource = [&reads](PixelImage& image)
+	{
+		reads++;
+		image.width = 40;
+		image.height = 40;
+		image.pixels.assign(40 * 40 * 4, 200);
+		return true;
+	};
+	std::vector<std::function<void()>> jobs;
+	auto post = [&jobs](std::function<void()> job) { jobs.push_back(job); };
+
+	ScaledBitmapKey whole = { "selftest_knob", 0 };
+	ScaledBitmapKey filmstrip = { "selftest_knob", 20 };
+	bool passed = true;
+	auto check = [&passed](bool ok, const char* what)
+	{
+		printf("  %-52s%s\n", what, ok ? "" : "  FAILED");
+		passed = passed && ok;
+	};
+
+	check(!ScaledBitmapCache::request(whole, 3, readSource, post) && jobs.empty(), "normal size is never rendered");
+	check(ScaledBitmapCache::request(whole, kSmall, readSource, post) && jobs.size() == 1 && reads == 1, "first request reads the source and posts one job");
+	check(ScaledBitmapCache::request(whole, kSmall, readSource, post) && jobs.size() == 1 && reads == 1, "a pending scale isn't posted again");
+	check(!ScaledBitmapCache::find(whole, kSmall), "nothing is found before the job runs");
+	jobs[0]();
+	ScaledBitmapCache::ImagePtr small = ScaledBitmapCache::find(whole, kSmall);
+	check(small && small->width == 30 && small->height == 30, "the job renders the requested scale (40 -> 30 pixels)");
+	check(!ScaledBitmapCache::find(whole, kLarge), "other scales stay unrendered");
+	check(ScaledBitmapCache::request(whole, kSmall, readSource, post) && jobs.size() == 1, "a rendered scale isn't posted again");
+
+	check(ScaledBitmapCache::request(filmstrip, kSmall, readSource, post) && jobs.size() == 2 && reads == 2, "a filmstrip is its own entry");
+	jobs[1]();
+	check(ScaledBitmapCache::find(filmstrip, kSmall) && ScaledBitmapCache::find(filmstrip, kSmall) != small, "and its own render");
+
+	check(ScaledBitmapCache::request(whole, kLarge, readSource, UIDescriptionCache::post) && reads == 2, "a second scale reuses the source");
+	ScaledBitmapCache::ImagePtr large;
+	for (uint32_t wait = 0; wait < 2000 && !large; wait++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		large = ScaledBitmapCache::find(whole, kLarge);
+	}
+	check(large && large->width == 46, "the editor cache's worker renders it (40 -> 46 pixels)");
+	return passed;
+}
+
+static const SelfTest kSelfTests[] = {
+	{ "noise-loop", testNoiseLoopDecorrelation },
+	{ "dense-controls", testDenseControls },
+	{ "unflagged-writes", testUnflaggedWrites },
+	{ "preset-morph", testPresetMorph },
+	{ "preset-bank", testPresetBank },
+	{ "state-chunk", testStateChunk },
+	{ "telemetry-meters", testTelemetryMeters },
+	{ "gui-change-tracking", testGUIChangeTracking },
+	{ "tape-echo", testTapeEcho },
+	{ "scaled-bitmaps", testScaledBitmaps },
+};
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> selected;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--list") == 0)
+		{
+			for (const SelfTest& test : kSelfTests)
+				printf("%s\n", test.name);
+			return 0;
+		}
+		selected.push_back(argv[i]);
+	}
+
+	int failures = 0;
+	int run = 0;
+	for (const SelfTest& test : kSelfTests)
+	{
+		bool wanted = selected.empty();
+		for (const std::string& name : selected)
+			wanted = wanted || name == test.name;
+		if (!wanted)
+			continue;
+
+		printf("%s\n", test.name);
+		bool passed = test.run();
+		printf("%s: %s\n", test.name, passed ? "passed" : "FAILED");
+		failures += passed ? 0 : 1;
+		run++;
+	}
+	if (run == 0 || run < (int)selected.size())
+	{
+		fprintf(stderr, "echoplex_selftest: unknown case (see --list)\n");
+		return 1;
+	}
+	return failures ? 1 : 0;
+}